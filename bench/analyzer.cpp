@@ -0,0 +1,57 @@
+// Semantic analysis over the tree (AnalyzerVisitor) compared with the linear
+// pass over the flat representation.
+//
+//     analyzer_bench [file.shf] [repetitions]
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "common.h"
+#include "flat_analyzer.h"
+#include "lexer.h"
+#include "parser/base.h"
+#include "analyzer/base.h"
+
+
+int main(int argc, char *argv[])
+{
+    std::string source = load_program(argc > 1 ? argv[1] : "", 50000);
+    int repetitions = argc > 2 ? std::stoi(argv[2]) : 5;
+
+    Lexer lexer(source);
+    const auto &tokens = lexer.tokenize();
+
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+
+    double tree_best = 1e9, parallel_best = 1e9, flatten_best = 1e9, flat_best = 1e9;
+    size_t nodes = 0;
+
+    for (int i = 0; i < repetitions; ++i)
+    {
+        Context context;
+        Parser parser(tokens, context);
+        auto ast = parser.parse();
+
+        // the tree analyzer mutates the tree, so flatten a pristine copy first
+        FlatTree tree;
+        flatten_best = std::min(flatten_best, seconds([&] { tree = flatten(ast); }));
+        nodes = tree.size();
+
+        tree_best = std::min(tree_best, seconds([&] { analyze(ast, context, 1); }));
+
+        // analysis is idempotent, the second run sees the same tree
+        parallel_best = std::min(parallel_best, seconds([&] { analyze(ast, context, cores); }));
+
+        flat_best = std::min(flat_best, seconds([&] { analyze_flat(tree); }));
+    }
+
+    std::cout << nodes << " nodes, best of " << repetitions << "\n";
+    std::cout << "tree analyzer:  " << tree_best * 1000 << " ms\n";
+    std::cout << "tree, " << cores << " jobs:  " << parallel_best * 1000 << " ms\n";
+    std::cout << "flatten:        " << flatten_best * 1000 << " ms\n";
+    std::cout << "flat analyzer:  " << flat_best * 1000 << " ms\n";
+
+    return 0;
+}
@@ -0,0 +1,59 @@
+// Code generation and object emission with an increasing number of worker
+// threads, up to the number of cores.
+//
+//     codegen_bench [file.shf] [repetitions]
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "lexer.h"
+#include "parser/base.h"
+#include "analyzer/base.h"
+#include "generator.h"
+
+// after the LLVM headers, its `seconds` would shadow std::chrono::seconds in them
+#include "common.h"
+
+
+int main(int argc, char *argv[])
+{
+    std::string source = load_program(argc > 1 ? argv[1] : "", 5000);
+    int repetitions = argc > 2 ? std::stoi(argv[2]) : 3;
+
+    Lexer lexer(source);
+    const auto &tokens = lexer.tokenize();
+
+    Context context;
+    Parser parser(tokens, context);
+    auto ast = parser.parse();
+
+    analyze(ast, context, 1);
+
+    auto directory = std::filesystem::temp_directory_path() / "shift_codegen_bench";
+    std::filesystem::create_directories(directory);
+    std::string stem = (directory / "bench").string();
+
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    double single = 0;
+
+    std::cout << ast.size() << " declarations, best of " << repetitions << "\n";
+
+    for (unsigned jobs = 1; jobs <= cores; jobs = jobs < cores ? std::min(jobs * 2, cores) : jobs + 1)
+    {
+        double best = 1e9;
+
+        for (int i = 0; i < repetitions; ++i)
+            best = std::min(best, seconds([&] { generate_partitions(ast, stem, jobs); }));
+
+        if (jobs == 1)
+            single = best;
+
+        std::cout << "-j" << jobs << ": " << best * 1000 << " ms (" << single / best << "x)\n";
+    }
+
+    std::filesystem::remove_all(directory);
+    return 0;
+}
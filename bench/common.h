@@ -0,0 +1,57 @@
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include <chrono>
+#include <string>
+
+#include "source.h"
+
+
+// Synthetic program with `functions` loop-heavy functions and a main
+inline std::string generate_program(size_t functions)
+{
+    std::string source = "extern fn printf(fmt: str, ..) -> int;\n\n";
+
+    for (size_t i = 0; i < functions; ++i)
+    {
+        // "f32" and "f64" are types, so not "f" + i
+        std::string name = "work" + std::to_string(i);
+
+        source += "fn " + name + "(n: int, m: int) -> int\n{\n";
+        source += "    let acc = 0;\n";
+        source += "    let div = 2;\n";
+        source += "    while (div <= n / 2 and not (m == 0))\n    {\n";
+        source += "        if (n % div == 0)\n            acc = acc + div * (m - 1);\n";
+        source += "        else\n            acc = acc - 1;\n";
+        source += "        div = div + 1;\n    }\n";
+        source += "    printf(\"%d\\n\", acc);\n";
+        source += "    return acc + n * m - (n & m | 3);\n}\n\n";
+    }
+
+    source += "fn main() -> int\n{\n    return 0;\n}\n";
+    return source;
+}
+
+// Contents of `path`, or a generated program when it's empty
+inline std::string load_program(const std::string &path, size_t functions)
+{
+    if (path.empty())
+        return generate_program(functions);
+
+    auto file = SourceBuffer::open(path);
+    while (file->fill()) {}
+
+    return std::string(file->view());
+}
+
+template <class F>
+double seconds(F &&f)
+{
+    auto begin = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+    return elapsed.count();
+}
+
+#endif
@@ -0,0 +1,272 @@
+#include <bit>
+
+#include "ast.h"
+#include "flat.h"
+
+using namespace ast;
+
+
+NodeIndex FlatTree::add(NodeKind kind, NodeIndex first, Type type)
+{
+    kinds.push_back(kind);
+    types.push_back(type);
+    this->first.push_back(first);
+    a.push_back(no_node);
+    b.push_back(no_node);
+    c.push_back(no_node);
+    value.push_back(0);
+
+    return static_cast<NodeIndex>(kinds.size() - 1);
+}
+
+
+namespace
+{
+    // Emits children before their parent, `lastIndex` is the node just emitted
+    class FlattenVisitor : public Visitor
+    {
+        FlatTree &tree;
+        NodeIndex lastIndex = no_node;
+
+        NodeIndex emit(ASTNode *node)
+        {
+            if (node == nullptr)
+                return no_node;
+
+            node->accept(*this);
+            return lastIndex;
+        }
+
+        template <class T>
+        std::vector<NodeIndex> emit_all(std::span<T *> items)
+        {
+            std::vector<NodeIndex> indices;
+            indices.reserve(items.size());
+
+            for (auto item : items)
+                indices.push_back(emit(item));
+
+            return indices;
+        }
+
+        void set_list(NodeIndex node, const std::vector<NodeIndex> &items)
+        {
+            tree.a[node] = static_cast<uint32_t>(tree.lists.size());
+            tree.b[node] = static_cast<uint32_t>(items.size());
+            tree.lists.insert(tree.lists.end(), items.begin(), items.end());
+        }
+
+        NodeIndex next() const { return static_cast<NodeIndex>(tree.size()); }
+
+    public:
+        explicit FlattenVisitor(FlatTree &tree) : tree(tree) {}
+
+        NodeIndex flatten(ASTNode &node)
+        {
+            node.accept(*this);
+            return lastIndex;
+        }
+
+        // Literals
+        void visit(Number &node) override
+        {
+            lastIndex = tree.add(NodeKind::Number, next(), node.type);
+            tree.value[lastIndex] = is_float(node.type) ? std::bit_cast<uint64_t>(node.real) : node.value;
+        }
+
+        void visit(String &node) override
+        {
+            lastIndex = tree.add(NodeKind::String, next(), node.type);
+            tree.value[lastIndex] = tree.strings.size();
+            tree.strings.push_back(node.value);
+        }
+
+        void visit(Boolean &node) override
+        {
+            lastIndex = tree.add(NodeKind::Boolean, next(), node.type);
+            tree.value[lastIndex] = node.value;
+        }
+
+        void visit(ArrayLiteral &node) override
+        {
+            NodeIndex first = next();
+            auto elements = emit_all(node.elements);
+
+            lastIndex = tree.add(NodeKind::ArrayLiteral, first, node.type);
+            set_list(lastIndex, elements);
+        }
+
+        // Statements
+        void visit(VariableDecl &node) override
+        {
+            NodeIndex first = next();
+            NodeIndex init = emit(node.init);
+
+            lastIndex = tree.add(NodeKind::VariableDecl, first, node.type);
+            tree.a[lastIndex] = init;
+            tree.c[lastIndex] = node.isConst;
+            tree.value[lastIndex] = node.name.id;
+        }
+
+        void visit(Assignment &node) override
+        {
+            NodeIndex first = next();
+            NodeIndex lhs = emit(node.lhs);
+            NodeIndex rhs = emit(node.rhs);
+
+            lastIndex = tree.add(NodeKind::Assignment, first);
+            tree.a[lastIndex] = lhs;
+            tree.b[lastIndex] = rhs;
+        }
+
+        void visit(Block &node) override
+        {
+            NodeIndex first = next();
+            auto statements = emit_all(node.statements);
+
+            lastIndex = tree.add(NodeKind::Block, first);
+            set_list(lastIndex, statements);
+        }
+
+        void visit(If &node) override
+        {
+            NodeIndex first = next();
+            NodeIndex cond = emit(node.cond);
+            NodeIndex then_branch = emit(node.then_branch);
+            NodeIndex else_branch = emit(node.else_branch);
+
+            lastIndex = tree.add(NodeKind::If, first);
+            tree.a[lastIndex] = cond;
+            tree.b[lastIndex] = then_branch;
+            tree.c[lastIndex] = else_branch;
+            tree.value[lastIndex] = static_cast<uint64_t>(node.hint);
+        }
+
+        void visit(While &node) override
+        {
+            NodeIndex first = next();
+            NodeIndex cond = emit(node.cond);
+            NodeIndex body = emit(node.body);
+
+            lastIndex = tree.add(NodeKind::While, first);
+            tree.a[lastIndex] = cond;
+            tree.b[lastIndex] = body;
+            tree.value[lastIndex] = static_cast<uint64_t>(node.hint);
+        }
+
+        void visit(Return &node) override
+        {
+            NodeIndex first = next();
+            NodeIndex value = emit(node.value);
+
+            lastIndex = tree.add(NodeKind::Return, first);
+            tree.a[lastIndex] = value;
+        }
+
+        void visit(ExprStatement &node) override
+        {
+            NodeIndex first = next();
+            NodeIndex expression = emit(node.expression);
+
+            lastIndex = tree.add(NodeKind::ExprStatement, first);
+            tree.a[lastIndex] = expression;
+        }
+
+        // Expressions
+        void visit(Variable &node) override
+        {
+            lastIndex = tree.add(NodeKind::Variable, next(), node.type);
+            tree.value[lastIndex] = node.name.id;
+        }
+
+        void visit(CallExpr &node) override
+        {
+            NodeIndex first = next();
+            auto args = emit_all(node.args);
+
+            lastIndex = tree.add(NodeKind::CallExpr, first, node.type);
+            set_list(lastIndex, args);
+            tree.value[lastIndex] = node.callee.id;
+        }
+
+        void visit(BinaryOp &node) override
+        {
+            NodeIndex first = next();
+            NodeIndex lhs = emit(node.lhs);
+            NodeIndex rhs = emit(node.rhs);
+
+            lastIndex = tree.add(NodeKind::BinaryOp, first, node.type);
+            tree.a[lastIndex] = lhs;
+            tree.b[lastIndex] = rhs;
+            tree.value[lastIndex] = static_cast<uint64_t>(node.op);
+        }
+
+        void visit(UnaryOp &node) override
+        {
+            NodeIndex first = next();
+            NodeIndex rhs = emit(node.rhs);
+
+            lastIndex = tree.add(NodeKind::UnaryOp, first, node.type);
+            tree.a[lastIndex] = rhs;
+            tree.value[lastIndex] = static_cast<uint64_t>(node.op);
+        }
+
+        void visit(Index &node) override
+        {
+            NodeIndex first = next();
+            NodeIndex base = emit(node.base);
+            NodeIndex index = emit(node.index);
+
+            lastIndex = tree.add(NodeKind::Index, first, node.type);
+            tree.a[lastIndex] = base;
+            tree.b[lastIndex] = index;
+        }
+
+        // Declarations
+        void visit(Prototype &node) override
+        {
+            NodeIndex first = next();
+            auto args = emit_all(node.args);
+
+            lastIndex = tree.add(NodeKind::Prototype, first, node.retType);
+            set_list(lastIndex, args);
+            tree.c[lastIndex] = (node.isExtern ? proto_extern : 0) | (node.isVarArg ? proto_vararg : 0);
+            tree.value[lastIndex] = node.name.id;
+        }
+
+        void visit(Definition &node) override
+        {
+            NodeIndex first = next();
+            NodeIndex proto = emit(node.type);
+            tree.c[proto] |= proto_defined;
+
+            NodeIndex body = emit(node.body);
+
+            lastIndex = tree.add(NodeKind::Definition, first);
+            tree.a[lastIndex] = proto;
+            tree.b[lastIndex] = body;
+        }
+
+        void visit(Parameter &node) override
+        {
+            NodeIndex first = next();
+            NodeIndex init = emit(node.init);
+
+            lastIndex = tree.add(NodeKind::Parameter, first, node.type);
+            tree.a[lastIndex] = init;
+            tree.value[lastIndex] = node.name.id;
+        }
+    };
+}
+
+
+FlatTree ast::flatten(std::span<Declaration *> declarations)
+{
+    FlatTree tree;
+    FlattenVisitor flattener(tree);
+
+    for (auto declaration : declarations)
+        tree.roots.push_back(flattener.flatten(*declaration));
+
+    return tree;
+}
@@ -0,0 +1,93 @@
+#ifndef BENCH_FLAT_H
+#define BENCH_FLAT_H
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "ast/base.h"
+
+
+namespace ast
+{
+    using NodeIndex = uint32_t;
+    inline constexpr NodeIndex no_node = std::numeric_limits<NodeIndex>::max();
+
+    // Prototype flags, stored in `c`
+    enum PrototypeFlags : uint32_t
+    {
+        proto_extern = 1 << 0,
+        proto_vararg = 1 << 1,
+        proto_defined = 1 << 2  // prototype of a Definition
+    };
+
+    // The AST as parallel columns instead of a tree of objects. Nodes are
+    // stored in post-order, so every child comes before its parent and a
+    // subtree occupies the contiguous range [first[i], i]. Passes can run as
+    // one linear sweep over the columns.
+    //
+    // The compiler analyzes and generates code from the tree and doesn't
+    // build this form. It lives with analyzer_bench, which times a linear
+    // analysis pass over it against the tree walk.
+    //
+    // What `a`, `b`, `c` and `value` hold depends on the kind:
+    //
+    //     Number         value = integer value, or the bits of the double
+    //                    for float types
+    //     Boolean        value = 0 or 1
+    //     String         value = index into `strings`
+    //     ArrayLiteral   a/b = elements as a range in `lists`
+    //     Variable       value = identifier id
+    //     CallExpr       value = callee id, a/b = args as a range in `lists`
+    //     BinaryOp       value = BinaryOpType, a = lhs, b = rhs
+    //     UnaryOp        value = UnaryOpType, a = operand, type = the target
+    //                    type of a conversion
+    //     Index          a = array or slice, b = index
+    //     VariableDecl   value = name id, a = initializer, c = 1 for a const,
+    //                    type = declared type
+    //     Assignment     a = Variable or Index, b = value
+    //     Block          a/b = statements as a range in `lists`
+    //     If             a = condition, b = then block, c = else block,
+    //                    value = BranchHint
+    //     While          a = condition, b = body, value = BranchHint
+    //     Return         a = value
+    //     ExprStatement  a = expression
+    //     Parameter      value = name id, a = initializer, type = declared type
+    //     Prototype      value = name id, a/b = parameters as a range in `lists`,
+    //                    c = PrototypeFlags, type = return type
+    //     Definition     a = Prototype, b = body
+    //
+    // Links that aren't there are `no_node`.
+    class FlatTree
+    {
+    public:
+        std::vector<NodeKind> kinds;
+        std::vector<Type> types;
+        std::vector<NodeIndex> first;
+        std::vector<uint32_t> a, b, c;
+        std::vector<uint64_t> value;
+
+        std::vector<NodeIndex> lists;
+        std::vector<std::string_view> strings;
+
+        // top-level declarations, in source order
+        std::vector<NodeIndex> roots;
+
+        size_t size() const { return kinds.size(); }
+
+        std::span<const NodeIndex> list(NodeIndex node) const
+        {
+            return std::span<const NodeIndex>(lists).subspan(a[node], b[node]);
+        }
+
+        NodeIndex add(NodeKind kind, NodeIndex first, Type type = Type::Unknown);
+    };
+
+    // Flattens a tree produced by the parser. The tree itself isn't touched,
+    // so consumers of it keep working.
+    FlatTree flatten(std::span<Declaration *> declarations);
+}
+
+#endif
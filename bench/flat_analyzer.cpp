@@ -0,0 +1,349 @@
+#include <bit>
+#include <cstdint>
+#include <format>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "flat_analyzer.h"
+#include "analyzer/typing.h"
+
+using namespace ast;
+
+
+namespace
+{
+    struct Binding
+    {
+        uint64_t name;
+        Type type;
+        NodeIndex declaredAt;
+    };
+
+    // variables declared inside the subtree rooted at `node` go out of scope
+    void end_scope(std::vector<Binding> &variables, const FlatTree &tree, NodeIndex node)
+    {
+        while (!variables.empty() && variables.back().declaredAt >= tree.first[node])
+            variables.pop_back();
+    }
+
+    // Gives a numeric literal, possibly negated, the type its context expects
+    void convert_literal(FlatTree &tree, NodeIndex node, Type target, bool negated = false)
+    {
+        // "[1, 2]" as a [f64; 2] or a []f64
+        if (tree.kinds[node] == NodeKind::ArrayLiteral && is_composite(target))
+        {
+            auto elements = tree.list(node);
+            if (is_array(target) && array_length(target) != elements.size())
+                return;
+
+            Type element = element_type(target);
+            for (NodeIndex item : elements)
+            {
+                convert_literal(tree, item, element);
+                if (tree.types[item] != element)
+                    return;
+            }
+
+            tree.types[node] = array_type(element, elements.size());
+            return;
+        }
+
+        Type type = tree.types[node];
+        if (type == target || !literal_converts(type, target))
+            return;
+
+        if (tree.kinds[node] == NodeKind::Number)
+        {
+            if (is_integer(type))
+            {
+                if (!integer_fits(tree.value[node], target, negated))
+                    return;
+                if (is_float(target))
+                    tree.value[node] = std::bit_cast<uint64_t>(static_cast<double>(tree.value[node]));
+            }
+
+            tree.types[node] = target;
+        }
+        else if (tree.kinds[node] == NodeKind::UnaryOp)
+        {
+            auto op = static_cast<UnaryOpType>(tree.value[node]);
+
+            bool sign = op == unary_add || (op == unary_sub && !is_unsigned(target));
+            if (!sign)
+                return;
+
+            convert_literal(tree, tree.a[node], target, negated != (op == unary_sub));
+            if (tree.types[tree.a[node]] == target)
+                tree.types[node] = target;
+        }
+    }
+
+    const Binding *lookup(const std::vector<Binding> &variables, uint64_t name)
+    {
+        for (auto binding = variables.rbegin(); binding != variables.rend(); ++binding)
+            if (binding->name == name)
+                return &*binding;
+
+        return nullptr;
+    }
+
+}
+
+
+// Post-order guarantees that operands are typed before the node using them
+// and that a declaration precedes every use in its scope.
+void analyze_flat(FlatTree &tree)
+{
+    std::vector<Binding> variables;
+    std::unordered_map<uint64_t, NodeIndex> functions;
+    Type currentFuncReturnType = Type::Void;
+
+    auto &types = tree.types;
+
+    for (NodeIndex i = 0; i < tree.size(); ++i)
+    {
+        switch (tree.kinds[i])
+        {
+        case NodeKind::Number:
+            // set by the parser from the literal, or converted by its parent
+            break;
+
+        case NodeKind::String:
+            types[i] = Type::String;
+            break;
+
+        case NodeKind::Boolean:
+            types[i] = Type::Bool;
+            break;
+
+        case NodeKind::ArrayLiteral:
+        {
+            auto elements = tree.list(i);
+
+            // the first element decides the type, literals among the rest take it
+            Type element = types[elements.front()];
+
+            if (is_composite(element) || element == Type::Void)
+                throw std::runtime_error("Arrays can only hold numbers, bools and strings");
+
+            for (NodeIndex item : elements)
+            {
+                convert_literal(tree, item, element);
+
+                if (types[item] != element)
+                    throw std::runtime_error(std::format("Array element of type {} in an array of {}", type_name(types[item]), type_name(element)));
+            }
+
+            types[i] = array_type(element, elements.size());
+            break;
+        }
+
+        case NodeKind::Variable:
+        {
+            const Binding *binding = lookup(variables, tree.value[i]);
+
+            if (binding == nullptr)
+                throw std::runtime_error("Referenced variable is undeclared");
+
+            types[i] = binding->type;
+            break;
+        }
+
+        case NodeKind::CallExpr:
+        {
+            // the builtin "len(xs)"
+            if (Identifier{uint32_t(tree.value[i])} == builtin::len)
+            {
+                auto args = tree.list(i);
+
+                if (args.size() != 1 || !is_composite(types[args[0]]))
+                    throw std::runtime_error("'len' takes one array or slice");
+
+                types[i] = Type::Int;
+                break;
+            }
+
+            auto found = functions.find(tree.value[i]);
+
+            if (found == functions.end())
+                throw std::runtime_error("Referenced function is undefined");
+
+            NodeIndex proto = found->second;
+            auto params = tree.list(proto);
+            auto args = tree.list(i);
+
+            if (!(tree.c[proto] & proto_vararg) && args.size() > params.size())
+                throw std::runtime_error(std::format("Too many arguments in call to '{}'", Identifier{uint32_t(tree.value[i])}.str()));
+
+            for (size_t arg = 0; arg < params.size(); ++arg)
+            {
+                if (arg >= args.size())
+                {
+                    if (tree.a[params[arg]] == no_node)
+                        throw std::runtime_error(std::format("Too few arguments in call to '{}'", Identifier{uint32_t(tree.value[i])}.str()));
+
+                    continue;
+                }
+
+                convert_literal(tree, args[arg], types[params[arg]]);
+
+                if (!assignable(types[args[arg]], types[params[arg]]))
+                    throw std::runtime_error(std::format("Type mismatch for parameter '{}' in call to '{}'",
+                                                         Identifier{uint32_t(tree.value[params[arg]])}.str(),
+                                                         Identifier{uint32_t(tree.value[i])}.str()));
+
+            }
+
+            types[i] = types[proto];
+            break;
+        }
+
+        case NodeKind::BinaryOp:
+            if (!is_integer_power(static_cast<BinaryOpType>(tree.value[i]), types[tree.a[i]], types[tree.b[i]]))
+                convert_literal(tree, tree.b[i], types[tree.a[i]]);
+            convert_literal(tree, tree.a[i], types[tree.b[i]]);
+
+            types[i] = binary_op_type(static_cast<BinaryOpType>(tree.value[i]), types[tree.a[i]], types[tree.b[i]]);
+            break;
+
+        case NodeKind::UnaryOp:
+            // the target type of a conversion comes from the parser
+            if (static_cast<UnaryOpType>(tree.value[i]) == unary_convert)
+                check_conversion(types[tree.a[i]], types[i]);
+            else
+                types[i] = unary_op_type(static_cast<UnaryOpType>(tree.value[i]), types[tree.a[i]]);
+            break;
+
+        case NodeKind::Index:
+        {
+            Type base = types[tree.a[i]];
+            NodeIndex index = tree.b[i];
+
+            if (!is_composite(base))
+                throw std::runtime_error("Only arrays and slices can be indexed");
+
+            if (!is_integer(types[index]))
+                throw std::runtime_error("Array index must be an integer");
+
+            // constant indices into arrays are checked here instead of at run time
+            if (tree.kinds[index] == NodeKind::Number && is_array(base) && tree.value[index] >= array_length(base))
+                throw std::runtime_error(std::format("Index {} is out of bounds for {}", tree.value[index], type_name(base)));
+
+            types[i] = element_type(base);
+            break;
+        }
+
+        case NodeKind::VariableDecl:
+        {
+            NodeIndex init = tree.a[i];
+
+            if (init == no_node && types[i] == Type::Unknown)
+                throw std::runtime_error("Missing type annotation in variable declaration");
+
+            if (has_named_length(types[i]))
+                throw std::runtime_error(std::format("Array length '{}' is a constant, which this pass doesn't evaluate", length_name(types[i]).str()));
+
+            if (init != no_node)
+            {
+                if (types[i] == Type::Unknown)
+                    types[i] = types[init];
+                else
+                    convert_literal(tree, init, types[i]);
+
+                if (!assignable(types[init], types[i]))
+                    throw std::runtime_error("Type mismatch when declaring a variable");
+            }
+
+            variables.push_back({tree.value[i], types[i], i});
+            break;
+        }
+
+        case NodeKind::Assignment:
+            convert_literal(tree, tree.b[i], types[tree.a[i]]);
+
+            if (!assignable(types[tree.b[i]], types[tree.a[i]]))
+                throw std::runtime_error("Type mismatch when assigning a variable");
+            break;
+
+        case NodeKind::Block:
+            end_scope(variables, tree, i);
+            break;
+
+        case NodeKind::If:
+        case NodeKind::While:
+            if (!is_scalar(types[tree.a[i]]))
+                throw std::runtime_error("If condition must be int or bool");
+            break;
+
+        case NodeKind::Return:
+        {
+            NodeIndex value = tree.a[i];
+
+            if (currentFuncReturnType == Type::Void && value != no_node)
+                throw std::runtime_error("Tried to return a value from a void function");
+
+            if (currentFuncReturnType != Type::Void && value == no_node)
+                throw std::runtime_error("No return value from a non-void function");
+
+            if (value != no_node)
+                convert_literal(tree, value, currentFuncReturnType);
+
+            // the array's storage goes away with the function
+            if (value != no_node && is_array(types[value]) && is_slice(currentFuncReturnType))
+                throw std::runtime_error("Returning a slice of a local array");
+
+            if (value != no_node && types[value] != currentFuncReturnType)
+                throw std::runtime_error("Return type mismatch");
+            break;
+        }
+
+        case NodeKind::ExprStatement:
+            break;
+
+        case NodeKind::Parameter:
+        {
+            NodeIndex init = tree.a[i];
+
+            if (init != no_node)
+            {
+                if (types[i] == Type::Unknown)
+                    types[i] = types[init];
+                else
+                    convert_literal(tree, init, types[i]);
+
+                if (!assignable(types[init], types[i]))
+                    throw std::runtime_error("Type mismatch when initializing a parameter");
+            }
+
+            if (is_array(types[i]))
+                throw std::runtime_error(std::format("Array parameter '{}' has to be a slice, e.g. '[]{}'",
+                                                     Identifier{uint32_t(tree.value[i])}.str(), type_name(element_type(types[i]))));
+            break;
+        }
+
+        case NodeKind::Prototype:
+            if (Identifier{uint32_t(tree.value[i])} == builtin::len)
+                throw std::runtime_error("'len' is a builtin function");
+
+            if (is_array(types[i]))
+                throw std::runtime_error("Functions can't return arrays, only slices");
+
+            functions[tree.value[i]] = i;
+
+            // the parameters are in scope for the body that follows
+            if (tree.c[i] & proto_defined)
+            {
+                currentFuncReturnType = types[i];
+
+                for (NodeIndex param : tree.list(i))
+                    variables.push_back({tree.value[param], types[param], i});
+            }
+            break;
+
+        case NodeKind::Definition:
+            end_scope(variables, tree, i);
+            break;
+        }
+    }
+}
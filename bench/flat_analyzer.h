@@ -0,0 +1,14 @@
+#ifndef BENCH_FLAT_ANALYZER_H
+#define BENCH_FLAT_ANALYZER_H
+
+#include "flat.h"
+
+
+// Type inference and checking over a FlatTree as a single linear sweep, to
+// compare against AnalyzerVisitor in analyzer_bench. The compiler doesn't run
+// it. Fills in `tree.types` using the operator rules of analyzer/typing.
+// Nothing is evaluated at compile time: there is no folding, constants are
+// checked like `let`, and array lengths named by a constant are rejected.
+void analyze_flat(ast::FlatTree &tree);
+
+#endif
@@ -0,0 +1,97 @@
+// Lexer throughput in MB/s for every SIMD level the CPU supports.
+//
+//     lexer_bench [file.shf] [repetitions]
+//
+// Without a file a synthetic source of roughly 64 MB is generated.
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "lexer.h"
+#include "lexer/simd.h"
+
+
+static const char *SAMPLE = R"(extern fn printf(fmt: str, ..) -> int;
+
+// checks every divisor up to n / 2, slow on purpose
+fn is_prime_candidate_with_a_long_name(number_to_check: int) -> bool
+{
+    if (number_to_check <= 1) return false;
+    if (number_to_check == 2 or number_to_check == 3) return true;
+
+    let current_divisor = 2;
+    while (current_divisor <= number_to_check / 2)
+    {
+        if (number_to_check % current_divisor == 0)
+            return false;
+
+        current_divisor = current_divisor + 1;
+    }
+
+    return true;
+}
+
+fn main() -> int
+{
+    let x = 0;
+    while (x < 200)
+    {
+        printf("%d -> \"%s\"\n", x, "a reasonably long string literal body");
+        x = x + 1;
+    }
+}
+)";
+
+
+int main(int argc, char *argv[])
+{
+    std::unique_ptr<SourceBuffer> file;
+    std::string generated;
+    std::string_view source;
+
+    if (argc > 1)
+    {
+        file = SourceBuffer::open(argv[1]);
+        while (file->fill()) {}
+        source = file->view();
+    }
+    else
+    {
+        while (generated.size() < 64 * 1024 * 1024)
+            generated += SAMPLE;
+        source = generated;
+    }
+
+    int repetitions = argc > 2 ? std::stoi(argv[2]) : 5;
+    double megabytes = source.size() / (1024.0 * 1024.0);
+
+    std::cout << "source: " << megabytes << " MB, best of " << repetitions << "\n";
+
+    for (auto level : {simd::Level::Scalar, simd::Level::SSE2, simd::Level::AVX2})
+    {
+        if (level > simd::detect())
+            break;
+
+        simd::set_level(level);
+
+        double best = 0;
+        size_t count = 0;
+
+        for (int i = 0; i < repetitions; ++i)
+        {
+            auto begin = std::chrono::steady_clock::now();
+
+            Lexer lexer(source);
+            count = lexer.tokenize().size();
+
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+            best = std::max(best, megabytes / elapsed.count());
+        }
+
+        std::cout << simd::level_name(level) << ": " << best << " MB/s (" << count << " tokens)\n";
+    }
+
+    return 0;
+}
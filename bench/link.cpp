@@ -0,0 +1,56 @@
+// Linking one small program with the in-process lld compared with going
+// through the gcc driver, which is what every CI compile used to pay for.
+//
+//     link_bench [file.shf] [repetitions]
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include "lexer.h"
+#include "parser/base.h"
+#include "analyzer/base.h"
+#include "generator.h"
+#include "linker.h"
+
+// after the LLVM headers, its `seconds` would shadow std::chrono::seconds in them
+#include "common.h"
+
+
+int main(int argc, char *argv[])
+{
+    std::string source = load_program(argc > 1 ? argv[1] : "", 10);
+    int repetitions = argc > 2 ? std::stoi(argv[2]) : 20;
+
+    Lexer lexer(source);
+    const auto &tokens = lexer.tokenize();
+
+    Context context;
+    Parser parser(tokens, context);
+    auto ast = parser.parse();
+
+    analyze(ast, context, 1);
+
+    auto directory = std::filesystem::temp_directory_path() / "shift_link_bench";
+    std::filesystem::create_directories(directory);
+    std::string output = (directory / "bench").string();
+
+    auto partitions = generate_partitions(ast, output, 1);
+    std::vector<std::string> objects = { partitions.front().objectPath };
+
+    std::cout << "best of " << repetitions << "\n";
+
+    double gcc = 1e9, lld = 1e9;
+    for (int i = 0; i < repetitions; ++i)
+    {
+        gcc = std::min(gcc, seconds([&] { link_executable(objects, output, { .systemLinker = true }); }));
+        lld = std::min(lld, seconds([&] { link_executable(objects, output, { .systemLinker = false }); }));
+    }
+
+    std::cout << "gcc: " << gcc * 1000 << " ms\n";
+    std::cout << "lld: " << lld * 1000 << " ms (" << gcc / lld << "x)\n";
+
+    std::filesystem::remove_all(directory);
+    return 0;
+}
@@ -0,0 +1,63 @@
+// Parse time (including tearing the tree down) and heap memory held by the AST.
+//
+//     parser_bench [file.shf] [repetitions]
+//
+// Without a file a synthetic program with many functions is generated.
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include <malloc.h>
+
+#include "common.h"
+#include "lexer.h"
+#include "parser/base.h"
+
+
+// bytes currently allocated through malloc/new, including mmapped chunks
+static size_t heap_in_use()
+{
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+
+int main(int argc, char *argv[])
+{
+    std::string source = load_program(argc > 1 ? argv[1] : "", 50000);
+    int repetitions = argc > 2 ? std::stoi(argv[2]) : 5;
+
+    Lexer lexer(source);
+    const auto &tokens = lexer.tokenize();
+
+    std::cout << "source: " << source.size() / (1024.0 * 1024.0) << " MB, " << tokens.size() << " tokens, best of " << repetitions << "\n";
+
+    double best = 1e9;
+    size_t declarations = 0;
+    size_t tree_bytes = 0;
+
+    for (int i = 0; i < repetitions; ++i)
+    {
+        auto begin = std::chrono::steady_clock::now();
+
+        {
+            size_t heap_before = heap_in_use();
+
+            Context context;
+            Parser parser(tokens, context);
+            declarations = parser.parse().size();
+
+            tree_bytes = heap_in_use() - heap_before;
+        }
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+        best = std::min(best, elapsed.count());
+    }
+
+    std::cout << "parse + teardown: " << best * 1000 << " ms (" << declarations << " declarations)\n";
+    std::cout << "tree memory: " << tree_bytes / (1024.0 * 1024.0) << " MB\n";
+
+    return 0;
+}
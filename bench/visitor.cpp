@@ -0,0 +1,186 @@
+// Cost of walking the AST through the virtual Visitor interface compared with
+// StaticVisitor's kind switch. Both visitors do the same trivial work per node
+// so the difference is the dispatch itself.
+//
+//     visitor_bench [file.shf] [repetitions]
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+#include "common.h"
+#include "lexer.h"
+#include "parser/base.h"
+
+
+namespace
+{
+    // node count and the sum of all number literals, results are kept in members
+    class VirtualWalker : public Visitor
+    {
+    public:
+        size_t nodes = 0;
+        long sum = 0;
+
+        void walk(ASTNode *node)
+        {
+            if (node != nullptr)
+                node->accept(*this);
+        }
+
+        void visit(Number &node) override { ++nodes; sum += node.value; }
+        void visit(String &node) override { ++nodes; }
+        void visit(Boolean &node) override { ++nodes; }
+        void visit(ArrayLiteral &node) override
+        {
+            ++nodes;
+            for (auto element : node.elements)
+                walk(element);
+        }
+
+        void visit(VariableDecl &node) override { ++nodes; walk(node.init); }
+        void visit(Assignment &node) override { ++nodes; walk(node.lhs); walk(node.rhs); }
+        void visit(Block &node) override
+        {
+            ++nodes;
+            for (auto statement : node.statements)
+                walk(statement);
+        }
+        void visit(If &node) override { ++nodes; walk(node.cond); walk(node.then_branch); walk(node.else_branch); }
+        void visit(While &node) override { ++nodes; walk(node.cond); walk(node.body); }
+        void visit(Return &node) override { ++nodes; walk(node.value); }
+        void visit(ExprStatement &node) override { ++nodes; walk(node.expression); }
+
+        void visit(Variable &node) override { ++nodes; }
+        void visit(CallExpr &node) override
+        {
+            ++nodes;
+            for (auto arg : node.args)
+                walk(arg);
+        }
+        void visit(BinaryOp &node) override { ++nodes; walk(node.lhs); walk(node.rhs); }
+        void visit(UnaryOp &node) override { ++nodes; walk(node.rhs); }
+        void visit(Index &node) override { ++nodes; walk(node.base); walk(node.index); }
+
+        void visit(Prototype &node) override
+        {
+            ++nodes;
+            for (auto arg : node.args)
+                walk(arg);
+        }
+        void visit(Definition &node) override { ++nodes; walk(node.type); walk(node.body); }
+        void visit(Parameter &node) override { ++nodes; walk(node.init); }
+    };
+
+    // same walk, each visit returns the sum of its subtree. `walk` is forced
+    // inline like `dispatch` so every call site gets its own switch, funnelling
+    // all nodes through one indirect jump predicts badly.
+    class StaticWalker : public StaticVisitor<StaticWalker, long>
+    {
+    public:
+        size_t nodes = 0;
+
+        [[gnu::always_inline]] long walk(ASTNode *node) { return node != nullptr ? dispatch(*node) : 0; }
+
+        long visit(Number &node) { ++nodes; return node.value; }
+        long visit(String &node) { ++nodes; return 0; }
+        long visit(Boolean &node) { ++nodes; return 0; }
+        long visit(ArrayLiteral &node)
+        {
+            ++nodes;
+            long sum = 0;
+            for (auto element : node.elements)
+                sum += walk(element);
+            return sum;
+        }
+
+        long visit(VariableDecl &node) { ++nodes; return walk(node.init); }
+        long visit(Assignment &node) { ++nodes; return walk(node.lhs) + walk(node.rhs); }
+        long visit(Block &node)
+        {
+            ++nodes;
+            long sum = 0;
+            for (auto statement : node.statements)
+                sum += walk(statement);
+            return sum;
+        }
+        long visit(If &node) { ++nodes; return walk(node.cond) + walk(node.then_branch) + walk(node.else_branch); }
+        long visit(While &node) { ++nodes; return walk(node.cond) + walk(node.body); }
+        long visit(Return &node) { ++nodes; return walk(node.value); }
+        long visit(ExprStatement &node) { ++nodes; return walk(node.expression); }
+
+        long visit(Variable &node) { ++nodes; return 0; }
+        long visit(CallExpr &node)
+        {
+            ++nodes;
+            long sum = 0;
+            for (auto arg : node.args)
+                sum += walk(arg);
+            return sum;
+        }
+        long visit(BinaryOp &node) { ++nodes; return walk(node.lhs) + walk(node.rhs); }
+        long visit(UnaryOp &node) { ++nodes; return walk(node.rhs); }
+        long visit(Index &node) { ++nodes; return walk(node.base) + walk(node.index); }
+
+        long visit(Prototype &node)
+        {
+            ++nodes;
+            long sum = 0;
+            for (auto arg : node.args)
+                sum += walk(arg);
+            return sum;
+        }
+        long visit(Definition &node) { ++nodes; return walk(node.type) + walk(node.body); }
+        long visit(Parameter &node) { ++nodes; return walk(node.init); }
+    };
+}
+
+
+int main(int argc, char *argv[])
+{
+    std::string source = load_program(argc > 1 ? argv[1] : "", 50000);
+    int repetitions = argc > 2 ? std::stoi(argv[2]) : 10;
+
+    Lexer lexer(source);
+    const auto &tokens = lexer.tokenize();
+
+    Context context;
+    Parser parser(tokens, context);
+    auto ast = parser.parse();
+
+    double virtual_best = 1e9, static_best = 1e9;
+    size_t virtual_nodes = 0, static_nodes = 0;
+    long virtual_sum = 0, static_sum = 0;
+
+    for (int i = 0; i < repetitions; ++i)
+    {
+        VirtualWalker virtual_walker;
+        virtual_best = std::min(virtual_best, seconds([&] {
+            for (auto declaration : ast)
+                virtual_walker.walk(declaration);
+        }));
+        virtual_nodes = virtual_walker.nodes;
+        virtual_sum = virtual_walker.sum;
+
+        StaticWalker static_walker;
+        static_best = std::min(static_best, seconds([&] {
+            static_sum = 0;
+            for (auto declaration : ast)
+                static_sum += static_walker.walk(declaration);
+        }));
+        static_nodes = static_walker.nodes;
+    }
+
+    if (virtual_nodes != static_nodes || virtual_sum != static_sum)
+    {
+        std::cerr << "walkers disagree: " << virtual_nodes << "/" << virtual_sum
+                  << " vs " << static_nodes << "/" << static_sum << "\n";
+        return 1;
+    }
+
+    std::cout << static_nodes << " nodes, best of " << repetitions << "\n";
+    std::cout << "virtual visitor: " << virtual_best * 1000 << " ms (" << virtual_best * 1e9 / virtual_nodes << " ns/node)\n";
+    std::cout << "static visitor:  " << static_best * 1000 << " ms (" << static_best * 1e9 / static_nodes << " ns/node)\n";
+
+    return 0;
+}
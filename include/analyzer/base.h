@@ -1,51 +1,108 @@
 #ifndef ANALYZER_BASE_H
 #define ANALYZER_BASE_H
 
-#include <vector>
+#include <mutex>
+#include <span>
 #include <string>
-#include <memory>
-#include <map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
+#include "analyzer/constant.h"
 #include "analyzer/symbols.h"
 #include "ast.h"
 
 using namespace ast;
 
 
-class AnalyzerVisitor : public Visitor
+// Makes nodes in a unit's context from several threads, for the literals that
+// folded expressions are replaced with
+class NodeFactory
 {
-    std::unique_ptr<SymbolTable> symbols = std::make_unique<SymbolTable>();
+    Context &context;
+    std::mutex mutex;
+
+public:
+    explicit NodeFactory(Context &context) : context(context) {}
+
+    template <class T, class... Args>
+    T *make(Args &&...args)
+    {
+        std::lock_guard lock(mutex);
+        return context.make<T>(std::forward<Args>(args)...);
+    }
+};
+
+
+// Checks function bodies against a finished FunctionTable. Variables live in
+// the visitor's own scope stack, so one instance per thread can check
+// different bodies at the same time.
+//
+// Once a statement is checked, the parts of its expressions that are known at
+// compile time are folded into literals: operators on literals, constants and
+// locals that are never assigned. Folding only starts after the checks, so a
+// folded literal never takes the type its context expects like a written one.
+class AnalyzerVisitor : public StaticVisitor<AnalyzerVisitor>
+{
+    const FunctionTable &functions;
+    NodeFactory &nodes;
+    ScopeStack scopes;
     Type currentFuncReturnType = Type::Int;
 
+    // names assigned anywhere in the current function
+    std::unordered_set<Identifier> assigned;
+
+    Expr *fold(Expr *expr);
+    Expr *fold_index(Index &node);
+    Expr *make_literal(const Constant &constant);
+
+    Type resolve_length(Type type);
+    void check_view(const Expr &value, Type target);
+
 public:
-    AnalyzerVisitor() {}
+    AnalyzerVisitor(const FunctionTable &functions, NodeFactory &nodes) : functions(functions), nodes(nodes) {}
 
-    void visit(Parameter &node) override;
+    void visit(Parameter &node);
 
     // Declaration Nodes
-    void visit(Prototype &node) override;
-    void visit(Definition &node) override;
+    void visit(Prototype &node);
+    void visit(Definition &node);
 
     // Statement Nodes
-    void visit(VariableDecl &node) override;
-    void visit(Assignment &node) override;
-    void visit(Block &node) override;
-    void visit(If &node) override;
-    void visit(While &node) override;
-    void visit(Return &node) override;
-    void visit(ExprStatement &node) override;
+    void visit(VariableDecl &node);
+    void visit(Assignment &node);
+    void visit(Block &node);
+    void visit(If &node);
+    void visit(While &node);
+    void visit(Return &node);
+    void visit(ExprStatement &node);
 
     // Expression Nodes
-    void visit(Variable &node) override;
-    void visit(CallExpr &node) override;
-    void visit(BinaryOp &node) override;
-    void visit(UnaryOp &node) override;
+    void visit(Variable &node);
+    void visit(CallExpr &node);
+    void visit(BinaryOp &node);
+    void visit(UnaryOp &node);
+    void visit(Index &node);
 
     // Literal Nodes
-    void visit(Number &node) override;
-    void visit(String &node) override;
-    void visit(Boolean &node) override;
+    void visit(Number &node);
+    void visit(String &node);
+    void visit(Boolean &node);
+    void visit(ArrayLiteral &node);
 };
 
 
-#endif
\ No newline at end of file
+// Semantic analysis in two phases. The first collects every prototype into the
+// function table, so declaration order doesn't matter, and adds implicit
+// returns. The second checks the function bodies on up to `jobs` threads.
+// Returns one message per failing declaration, in declaration order.
+std::vector<std::string> analyze(std::span<Declaration *> declarations, Context &context, unsigned jobs);
+
+// Gives parameters without an annotation the type of their default value, for
+// interfaces written before the unit is analyzed. Only literals, operators and
+// functions declared earlier in the unit are known then. Throws if a default
+// can't be typed that way.
+void infer_parameter_types(std::span<Declaration *> declarations, Context &context);
+
+
+#endif
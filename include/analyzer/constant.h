@@ -0,0 +1,28 @@
+#ifndef ANALYZER_CONSTANT_H
+#define ANALYZER_CONSTANT_H
+
+#include <cstdint>
+#include <optional>
+
+#include "operators.h"
+#include "types.h"
+
+
+// A scalar known at compile time. Integers and bools are kept in `bits`,
+// wrapped to the width of their type and sign-extended if it is signed, floats
+// in `real`, rounded to an f32 for f32s.
+struct Constant
+{
+    Type type;
+    uint64_t bits = 0;
+    double real = 0;
+};
+
+// Operators applied to constants, with the result the generated code would
+// compute. Nothing when that code would trap or be undefined, e.g. for a
+// division by zero, the operation then stays for run time. The operands have
+// been type checked.
+std::optional<Constant> fold_binary(BinaryOpType op, const Constant &lhs, const Constant &rhs);
+std::optional<Constant> fold_unary(UnaryOpType op, const Constant &operand, Type type);
+
+#endif
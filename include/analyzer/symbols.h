@@ -1,20 +1,28 @@
 #ifndef ANALYZER_SYMBOLS_H
 #define ANALYZER_SYMBOLS_H
 
+#include <unordered_map>
+#include <vector>
+
 #include "llvm/IR/Value.h"
 
+#include "ast/base.h"
+#include "interner.h"
 #include "types.h"
 
 
 struct Symbol
 {
-    std::string name;
+    Identifier name;
 };
 
 struct VarSymbol : public Symbol {
     Type type;
     bool isMutable = true;
     llvm::Value* llvmValue = nullptr;
+    // the literal a constant or a never assigned local was initialized with,
+    // or the array literal of a constant table
+    const ast::Expr* value = nullptr;
 };
 
 struct ParamSymbol : public Symbol {
@@ -32,21 +40,30 @@ struct FuncSymbol : public Symbol {
 };
 
 
-class SymbolTable
+// Every function of the program. Filled before any body is checked and only
+// read afterwards, so it can be shared between threads.
+class FunctionTable
+{
+private:
+    std::unordered_map<Identifier, FuncSymbol> functions;
+
+public:
+    void addFunction(const FuncSymbol& func);
+    const FuncSymbol* lookupFunction(Identifier name) const;
+};
+
+// Variables visible while checking one function body
+class ScopeStack
 {
 private:
-    std::unordered_map<std::string, FuncSymbol> functions;
-    std::vector<std::unordered_map<std::string, VarSymbol>> varScopes;
+    std::vector<std::unordered_map<Identifier, VarSymbol>> varScopes;
 
 public:
     void enterScope();
     void exitScope();
     
     void addVariable(const VarSymbol& var);
-    VarSymbol* lookupVariable(const std::string& name);
-
-    void addFunction(const FuncSymbol& func);
-    FuncSymbol* lookupFunction(const std::string& name);
+    VarSymbol* lookupVariable(Identifier name);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,34 @@
+#ifndef ANALYZER_TYPING_H
+#define ANALYZER_TYPING_H
+
+#include <cstdint>
+
+#include "operators.h"
+#include "types.h"
+
+
+// Result type of an operator applied to operands of the given types, throws
+// if the operands aren't valid for it. Shared by every analysis pass.
+Type binary_op_type(BinaryOpType op, Type lhs, Type rhs);
+Type unary_op_type(UnaryOpType op, Type operand);
+
+// Whether "x ** n" raises a float x to an int n, which multiplies x by itself
+// instead of calling pow. The int exponent isn't converted to the float type.
+bool is_integer_power(BinaryOpType op, Type lhs, Type rhs);
+
+// Throws unless a conversion such as "f64(x)" can turn `from` into `to`
+void check_conversion(Type from, Type to);
+
+// Whether a value of type `from` can be stored where a `to` is expected,
+// i.e. the types are equal or an array is passed as a slice of it
+bool assignable(Type from, Type to);
+
+// Whether a numeric literal of type `literal` can take the type `target`
+// instead. Integer literals become any numeric type, float literals any float type.
+bool literal_converts(Type literal, Type target);
+
+// Whether the value of an integer literal is in the range of the numeric type.
+// A negated literal may be one larger, down to the lowest int or i64.
+bool integer_fits(uint64_t value, Type type, bool negated = false);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+
+// Bump-pointer allocator. Memory is carved out of large blocks and is only
+// released all at once, when the arena itself is destroyed.
+class Arena
+{
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    std::vector<std::unique_ptr<std::byte[]>> blocks;
+    std::byte *cursor = nullptr;
+    std::byte *limit = nullptr;
+
+    void grow(size_t size);
+
+public:
+    Arena() = default;
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *allocate(size_t size, size_t align = alignof(std::max_align_t));
+    char *allocate_chars(size_t count);
+
+    // copies the string into the arena, the view is valid for the arena's lifetime
+    std::string_view store(std::string_view str);
+};
+
+#endif
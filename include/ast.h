@@ -2,6 +2,7 @@
 #define AST_H
 
 #include "ast/base.h"
+#include "ast/context.h"
 #include "ast/visitor.h"
 
 #endif
@@ -1,11 +1,13 @@
 #ifndef AST_BASE_H
 #define AST_BASE_H
 
-#include <memory>
+#include <cstdint>
 #include <ostream>
-#include <string>
-#include <vector>
+#include <span>
+#include <string_view>
+#include <unordered_set>
 
+#include "interner.h"
 #include "operators.h"
 #include "types.h"
 #include "utils.h"
@@ -14,40 +16,81 @@ namespace ast
 {
     class Visitor;
 
+    enum class NodeKind : uint8_t
+    {
+        // Literals
+        Number,
+        String,
+        Boolean,
+        ArrayLiteral,
+
+        // Expressions
+        Variable,
+        CallExpr,
+        BinaryOp,
+        UnaryOp,
+        Index,
+
+        // Statements
+        VariableDecl,
+        Assignment,
+        Block,
+        If,
+        While,
+        Return,
+        ExprStatement,
+
+        // Declarations
+        Prototype,
+        Definition,
+        Parameter
+    };
+
+    // Nodes live in an ast::Context and are never destroyed individually,
+    // so they have to stay trivially destructible. They have no vtable, `kind`
+    // names the concrete type and StaticVisitor switches on it.
     class ASTNode
     {
     public:
-        virtual void accept(Visitor &v) = 0;
-        virtual ~ASTNode() = default;
+        const NodeKind kind;
+
+        explicit ASTNode(NodeKind kind) : kind(kind) {}
+
+        // calls the matching Visitor::visit
+        void accept(Visitor &v);
     };
 
     class Expr : public ASTNode
     {
     public:
         Type type = Type::Unknown;
+
+        using ASTNode::ASTNode;
     };
 
     class Statement : public ASTNode
     {
+    public:
+        using ASTNode::ASTNode;
     };
 
     class Declaration : public ASTNode
     {
+    public:
+        using ASTNode::ASTNode;
     };
 
     class Parameter : public ASTNode
     {
     public:
         Type type;
-        std::string name;
-        std::unique_ptr<Expr> init;
+        Identifier name;
+        Expr *init;
 
         Parameter(
-            const std::string& name,
+            Identifier name,
             Type type = Type::Unknown,
-            std::unique_ptr<Expr> init = nullptr);
-
-        void accept(Visitor &v) override;
+            Expr *init = nullptr);
     };
 
     // - - - - - LITERALS - - - - - //
@@ -56,37 +99,49 @@ namespace ast
     {
     public:
         T value;
-        explicit Literal(T value) : value(value) {}
+        Literal(NodeKind kind, T value) : Expr(kind), value(value) {}
     };
 
-    class Number : public Literal<int>
+    // Integer literals keep their digits in `value` and float literals in
+    // `real`. The analyzer can give a literal the type its context expects,
+    // an integer literal used as a float gets `real` filled in then.
+    class Number : public Literal<uint64_t>
     {
     public:
-        Number(int value) : Literal<int>(value) {
-            type = Type::Int;
+        double real = 0;
+
+        Number(uint64_t value, Type type = Type::Int) : Literal<uint64_t>(NodeKind::Number, value) {
+            this->type = type;
         }
 
-        void accept(Visitor &v) override;
+        Number(double real, Type type) : Literal<uint64_t>(NodeKind::Number, 0), real(real) {
+            this->type = type;
+        }
     };
 
     class Boolean : public Literal<bool>
     {
     public:
-        Boolean(bool value) : Literal<bool>(value) {
+        Boolean(bool value) : Literal<bool>(NodeKind::Boolean, value) {
             type = Type::Bool;
         }
-
-        void accept(Visitor &v) override;
     };
 
-    class String : public Literal<std::string>
+    class String : public Literal<std::string_view>
     {
     public:
-        String(const std::string& value) : Literal<std::string>(value) {
+        String(std::string_view value) : Literal<std::string_view>(NodeKind::String, value) {
             type = Type::String;
         }
+    };
+
+    // "[1, 2, 3]", an array with the type of its elements
+    class ArrayLiteral : public Expr
+    {
+    public:
+        std::span<Expr *> elements;
 
-        void accept(Visitor &v) override;
+        ArrayLiteral(std::span<Expr *> elements);
     };
     // - - - - - - - - - - - - - - - //
 
@@ -94,50 +149,54 @@ namespace ast
     class Variable : public Expr
     {
     public:
-        std::string name;
+        Identifier name;
 
-        Variable(const std::string &name);
-        void accept(Visitor &v) override;
+        Variable(Identifier name);
     };
 
     class CallExpr : public Expr
     {
     public:
-        std::vector<std::unique_ptr<Expr>> args;
-        std::string callee;
+        std::span<Expr *> args;
+        Identifier callee;
 
         CallExpr(
-            const std::string &callee,
-            std::vector<std::unique_ptr<Expr>> args);
-
-        void accept(Visitor &v) override;
+            Identifier callee,
+            std::span<Expr *> args);
     };
 
     class BinaryOp : public Expr
     {
     public:
         BinaryOpType op;
-        std::unique_ptr<Expr> lhs, rhs;
+        Expr *lhs, *rhs;
 
         BinaryOp(
             BinaryOpType op,
-            std::unique_ptr<Expr> lhs,
-            std::unique_ptr<Expr> rhs);
-
-        void accept(Visitor &v) override;
+            Expr *lhs,
+            Expr *rhs);
     };
 
     class UnaryOp : public Expr
     {
     public:
         UnaryOpType op;
-        std::unique_ptr<Expr> rhs;
+        Expr *rhs;
 
         UnaryOp(
             UnaryOpType op,
-            std::unique_ptr<Expr> rhs);
+            Expr *rhs);
+    };
+
+    // "base[index]" on an array or a slice
+    class Index : public Expr
+    {
+    public:
+        Expr *base, *index;
 
-        void accept(Visitor &v) override;
+        Index(
+            Expr *base,
+            Expr *index);
     };
     // - - - - - - - - - - - - - - - - //
 
@@ -145,82 +204,82 @@ namespace ast
     class VariableDecl : public Statement
     {
     public:
-        std::string name;
+        Identifier name;
         Type type;
-        std::unique_ptr<Expr> init;
+        Expr *init;
+        // "const", never assigned and known at compile time
+        bool isConst = false;
 
-        VariableDecl(const std::string &name, Type type = Type::Unknown, std::unique_ptr<Expr> init = nullptr);
-
-        void accept(Visitor &v) override;
+        VariableDecl(Identifier name, Type type = Type::Unknown, Expr *init = nullptr);
     };
 
     class Assignment : public Statement
     {
     public:
-        std::unique_ptr<Variable> lhs;
-        std::unique_ptr<Expr> rhs;
+        Expr *lhs;  // a Variable or an Index
+        Expr *rhs;
 
         Assignment(
-            std::unique_ptr<Variable> lhs,
-            std::unique_ptr<Expr> rhs);
-
-        void accept(Visitor &v) override;
+            Expr *lhs,
+            Expr *rhs);
     };
     
     class Block : public Statement
     {
     public:
-        std::vector<std::unique_ptr<Statement>> statements;
+        std::span<Statement *> statements;
 
-        Block(std::vector<std::unique_ptr<Statement>> stmts);
-        Block(std::unique_ptr<Statement> stmt);
+        Block(std::span<Statement *> stmts);
         
-        void accept(Visitor &v) override;
+    };
+
+    // "if likely (...)", how often a branch's condition is expected to hold
+    enum class BranchHint
+    {
+        None,
+        Likely,
+        Unlikely
     };
 
     class If : public Statement
     {
     public:
-        std::unique_ptr<Expr> cond;
-        std::unique_ptr<Block> then_branch, else_branch;
+        Expr *cond;
+        Block *then_branch, *else_branch;
+        BranchHint hint = BranchHint::None;
 
         If(
-            std::unique_ptr<Expr> cond,
-            std::unique_ptr<Block> then_branch,
-            std::unique_ptr<Block> else_branch);
-
-        void accept(Visitor &v) override;
+            Expr *cond,
+            Block *then_branch,
+            Block *else_branch);
     };
 
     class While : public Statement
     {
     public:
-        std::unique_ptr<Expr> cond;
-        std::unique_ptr<Block> body;
+        Expr *cond;
+        Block *body;
+        BranchHint hint = BranchHint::None;
 
         While(
-            std::unique_ptr<Expr> cond,
-            std::unique_ptr<Block> body);
-
-        void accept(Visitor &v) override;
+            Expr *cond,
+            Block *body);
     };
 
     class Return : public Statement
     {
     public:
-        std::unique_ptr<Expr> value;
+        Expr *value;
 
-        Return(std::unique_ptr<Expr> value);
-        void accept(Visitor &v) override;
+        Return(Expr *value);
     };
 
     class ExprStatement : public Statement
     {
     public:
-        std::unique_ptr<Expr> expression;
+        Expr *expression;
 
-        ExprStatement(std::unique_ptr<Expr> expression);
-        void accept(Visitor &v) override;
+        ExprStatement(Expr *expression);
     };
     // - - - - - - - - - - - - - - - - //
 
@@ -229,35 +288,36 @@ namespace ast
     {
     public:
         Type retType;
-        std::vector<std::unique_ptr<Parameter>> args;
-        std::string name;
+        std::span<Parameter *> args;
+        Identifier name;
         bool isExtern = false;
         bool isVarArg = false;
+        // extern, but defined by another unit of the program rather than in C
+        bool isImported = false;
 
         Prototype(
             Type retType,
-            const std::string &name,
-            std::vector<std::unique_ptr<Parameter>> args,
+            Identifier name,
+            std::span<Parameter *> args,
             bool isExtern = false,
             bool isVarArg = false
         );
-
-        void accept(Visitor &v) override;
     };
 
     class Definition : public Declaration
     {
     public:
-        std::unique_ptr<Prototype> type;
-        std::unique_ptr<Block> body;
+        Prototype *type;
+        Block *body;
 
         Definition(
-            std::unique_ptr<Prototype> type,
-            std::unique_ptr<Block> body);
-
-        void accept(Visitor &v) override;
+            Prototype *type,
+            Block *body);
     };
     // - - - - - - - - - - - - -  - - - //
+
+    // names that are the target of an assignment anywhere in the statement
+    void collect_assigned(Statement &statement, std::unordered_set<Identifier> &names);
 }
 
 #endif
@@ -0,0 +1,74 @@
+#ifndef AST_CONTEXT_H
+#define AST_CONTEXT_H
+
+#include <algorithm>
+#include <initializer_list>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#include "arena.h"
+
+
+namespace ast
+{
+    // Owns every node of one compilation unit. Nodes are bump-allocated and
+    // never destroyed one by one, the whole tree goes away with the context.
+    class Context
+    {
+        Arena arena;
+
+    public:
+        Context() = default;
+        Context(const Context &) = delete;
+        Context &operator=(const Context &) = delete;
+
+        template <class T, class... Args>
+        T *make(Args &&...args)
+        {
+            static_assert(std::is_trivially_destructible_v<T>, "AST nodes are never destroyed");
+
+            void *memory = arena.allocate(sizeof(T), alignof(T));
+            return new (memory) T(std::forward<Args>(args)...);
+        }
+
+        // uninitialized list of `count` nodes
+        template <class T>
+        std::span<T *> make_list(size_t count)
+        {
+            T **memory = static_cast<T **>(arena.allocate(count * sizeof(T *), alignof(T *)));
+            return std::span<T *>(memory, count);
+        }
+
+        template <class T>
+        std::span<T *> list(std::span<T *const> items)
+        {
+            std::span<T *> result = make_list<T>(items.size());
+            std::copy(items.begin(), items.end(), result.begin());
+
+            return result;
+        }
+
+        template <class T>
+        std::span<T *> list(std::initializer_list<T *> items)
+        {
+            return list(std::span<T *const>(items.begin(), items.size()));
+        }
+
+        // copy of the list with one more item at the end
+        template <class T>
+        std::span<T *> append(std::span<T *> items, T *item)
+        {
+            std::span<T *> result = make_list<T>(items.size() + 1);
+            std::copy(items.begin(), items.end(), result.begin());
+            result.back() = item;
+
+            return result;
+        }
+
+        std::string_view store(std::string_view str) { return arena.store(str); }
+    };
+}
+
+#endif
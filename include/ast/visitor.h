@@ -14,6 +14,7 @@ namespace ast
         virtual void visit(Number &node) = 0;
         virtual void visit(String &node) = 0;
         virtual void visit(Boolean &node) = 0;
+        virtual void visit(ArrayLiteral &node) = 0;
 
         // Statements
         virtual void visit(VariableDecl &node) = 0;
@@ -29,6 +30,7 @@ namespace ast
         virtual void visit(CallExpr &node) = 0;
         virtual void visit(BinaryOp &node) = 0;
         virtual void visit(UnaryOp &node) = 0;
+        virtual void visit(Index &node) = 0;
 
         // Declarations
         virtual void visit(Prototype &node) = 0;
@@ -36,6 +38,74 @@ namespace ast
 
         virtual void visit(Parameter &node) = 0;
     };
+
+    // Compile-time dispatched visitor. `dispatch` switches on the node kind and
+    // calls Derived::visit directly, so the calls can be inlined and visits
+    // return their result instead of storing it in the visitor. It is forced
+    // inline so every call site gets its own switch (and branch history).
+    //
+    //     class Counter : public StaticVisitor<Counter, size_t> { ... };
+    template <class Derived, class R = void>
+    class StaticVisitor
+    {
+        Derived &self() { return static_cast<Derived &>(*this); }
+
+    public:
+        [[gnu::always_inline]] R dispatch(ASTNode &node)
+        {
+            switch (node.kind)
+            {
+            // Literals
+            case NodeKind::Number:
+                return self().visit(static_cast<Number &>(node));
+            case NodeKind::String:
+                return self().visit(static_cast<String &>(node));
+            case NodeKind::Boolean:
+                return self().visit(static_cast<Boolean &>(node));
+            case NodeKind::ArrayLiteral:
+                return self().visit(static_cast<ArrayLiteral &>(node));
+
+            // Statements
+            case NodeKind::VariableDecl:
+                return self().visit(static_cast<VariableDecl &>(node));
+            case NodeKind::Assignment:
+                return self().visit(static_cast<Assignment &>(node));
+            case NodeKind::Block:
+                return self().visit(static_cast<Block &>(node));
+            case NodeKind::If:
+                return self().visit(static_cast<If &>(node));
+            case NodeKind::While:
+                return self().visit(static_cast<While &>(node));
+            case NodeKind::Return:
+                return self().visit(static_cast<Return &>(node));
+            case NodeKind::ExprStatement:
+                return self().visit(static_cast<ExprStatement &>(node));
+
+            // Expressions
+            case NodeKind::Variable:
+                return self().visit(static_cast<Variable &>(node));
+            case NodeKind::CallExpr:
+                return self().visit(static_cast<CallExpr &>(node));
+            case NodeKind::BinaryOp:
+                return self().visit(static_cast<BinaryOp &>(node));
+            case NodeKind::UnaryOp:
+                return self().visit(static_cast<UnaryOp &>(node));
+            case NodeKind::Index:
+                return self().visit(static_cast<Index &>(node));
+
+            // Declarations
+            case NodeKind::Prototype:
+                return self().visit(static_cast<Prototype &>(node));
+            case NodeKind::Definition:
+                return self().visit(static_cast<Definition &>(node));
+
+            case NodeKind::Parameter:
+                return self().visit(static_cast<Parameter &>(node));
+            }
+
+            __builtin_unreachable();
+        }
+    };
 }
 
 #endif
\ No newline at end of file
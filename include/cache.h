@@ -0,0 +1,67 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// SHA-256 over the parts, each length-prefixed so their boundaries count too
+std::string cache_key(std::initializer_list<std::string_view> parts);
+
+// Identifies this build of the compiler: its executable and the LLVM version
+std::string compiler_identity();
+
+// Content-addressed store of compiler outputs on disk. An entry is a directory
+// of files named after its key, plus a count of them. Entries are written to a
+// temporary directory and renamed into place, and evicted entries are renamed
+// out before they are deleted, so concurrent compilers never see half an
+// entry. A hit refreshes the entry's modification time, and the least recently
+// used entries are evicted once the cache grows past its size limit.
+class CompileCache
+{
+public:
+    static constexpr uint64_t DEFAULT_MAX_BYTES = 1ull << 30;
+
+    struct Stats
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t entries = 0;
+        uint64_t bytes = 0;
+    };
+
+    // $SHIFT_CACHE_DIR, else $XDG_CACHE_HOME/shift or ~/.cache/shift
+    static std::filesystem::path default_directory();
+
+    explicit CompileCache(std::filesystem::path root, uint64_t maxBytes = DEFAULT_MAX_BYTES);
+
+    // the entry's files in the order they were stored
+    std::optional<std::vector<std::filesystem::path>> fetch(const std::string &key);
+
+    // counts one compile toward the hit rate, a hit when it reused cached
+    // output instead of generating code. Compiles look up several entries, so
+    // fetch doesn't count them.
+    void record(bool hit);
+
+    // copies the files in as one entry, then evicts down to the size limit
+    // unless told not to, e.g. while storing many entries in a row
+    void store(const std::string &key, const std::vector<std::filesystem::path> &files, bool evictAfter = true);
+
+    // removes the least recently used entries until the cache fits its limit
+    void evict();
+
+    Stats stats() const;
+
+private:
+    std::filesystem::path root;
+    uint64_t maxBytes;
+
+    std::filesystem::path entries() const { return root / "entries"; }
+};
+
+#endif
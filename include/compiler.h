@@ -1,8 +1,49 @@
 #ifndef COMPILER_H
 #define COMPILER_H
 
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
 #include <string>
+#include <thread>
+#include <vector>
 
-int compile(const std::string& filepath);
+#include "cache.h"
+#include "generator/options.h"
+#include "linker.h"
+
+struct CompileOptions
+{
+    // worker threads for analysis and code generation
+    unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+    // modules a file's definitions are split into, generated on separate
+    // threads. A single module lets every function be inlined into any other,
+    // so only an explicit -j splits it.
+    unsigned partitions = 1;
+
+    CodegenOptions codegen;
+    LinkOptions link;
+
+    // where compiled objects and executables are cached, empty turns it off
+    std::filesystem::path cacheDirectory = CompileCache::default_directory();
+    uint64_t cacheSize = CompileCache::DEFAULT_MAX_BYTES;
+
+    // compile every function into its own object and reuse the cached objects
+    // of unchanged ones. Needs the cache, and gives up inlining across functions.
+    bool incremental = false;
+};
+
+int compile(const std::string& filepath, const CompileOptions &options = {});
+
+// Compiles every file as its own translation unit, in parallel, and links them
+// into one executable named after the first file. Units see each other's
+// functions through interfaces, "<name>.shi", written next to the objects.
+int compile(const std::vector<std::string>& filepaths, const CompileOptions &options = {});
+
+// compiles the file in memory and runs its main, returning main's exit code
+int run(const std::string& filepath, const CompileOptions &options = {});
+
+// prints the hit rate and size of the compile cache
+int print_cache_stats(const CompileOptions &options = {});
 
 #endif
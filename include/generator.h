@@ -2,5 +2,8 @@
 #define GENERATOR_H
 
 #include "generator/base.h"
+#include "generator/parallel.h"
+#include "generator/jit.h"
+#include "generator/incremental.h"
 
 #endif
@@ -4,7 +4,8 @@
 #include <vector>
 #include <string>
 #include <memory>
-#include <map>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
@@ -37,66 +38,126 @@
 #include "llvm/Passes/StandardInstrumentations.h"
 
 #include "ast.h"
+#include "generator/options.h"
 
 
 using namespace ast;
 
 
-// Refactor context/module logic into a separate class like "Generator" or sum
-class CodegenVisitor : public Visitor
+// The options with a "native" CPU replaced by the host CPU and its features,
+// as the generator will see them
+CodegenOptions resolve_target(const CodegenOptions &options);
+
+// prototypes by name, for generators that only declare what they call
+using PrototypeTable = std::unordered_map<Identifier, Prototype *>;
+
+// Generates one llvm::Module. Every instance owns its context and target
+// machine, so separate instances can run on separate threads.
+class CodegenVisitor : public StaticVisitor<CodegenVisitor, llvm::Value *>
 {
 private:
-    llvm::Value* lastValue = nullptr;
+    std::unique_ptr<llvm::LLVMContext> context;
+    std::unique_ptr<llvm::Module> module;
     std::unique_ptr<llvm::IRBuilder<>> builder;
-    std::map<std::string, llvm::AllocaInst *> namedValues;
+    // a local is either an alloca in the entry block or, when it is never
+    // assigned after its declaration, its SSA value itself
+    std::unordered_map<Identifier, llvm::Value *> namedValues;
+    std::unordered_set<Identifier> assignedNames;
+    std::unordered_map<Identifier, llvm::Function *> functions;
+    const PrototypeTable *calleePrototypes = nullptr;
 
-    llvm::TargetMachine *targetMachine;
+    CodegenOptions options;
+    std::unique_ptr<llvm::TargetMachine> targetMachine;
+
+    // the trap every failed bounds check of the current function branches to
+    llvm::BasicBlock *boundsFailure = nullptr;
 
     llvm::Type* type_to_llvm_type(Type type);
+    llvm::Value *bind_local(Identifier name, llvm::Value *value);
+    llvm::AllocaInst *create_entry_alloca(llvm::Type *type, const llvm::Twine &name);
+    // value of type `from` as a `to`, for conversions such as "f64(n)"
+    llvm::Value *convert(llvm::Value *value, Type from, Type to);
+
+    // "a and b" only evaluates b when a is true, "a or b" when a is false
+    llvm::Value *short_circuit(BinaryOp &node);
+    // !prof weights for a branch with a likely or unlikely hint, null without
+    llvm::MDNode *branch_weights(BranchHint hint);
+
+    // "x ** n": small constant exponents become a chain of multiplications,
+    // other integer ones a square-and-multiply loop, floats call powi or pow
+    llvm::Value *power(llvm::Value *base, llvm::Value *exponent, Type type, Type exponentType);
+    llvm::Value *multiply_chain(llvm::Value *base, uint64_t count);
+    llvm::Value *power_loop(llvm::Value *base, llvm::Value *exponent, Type type);
+
+    // Arrays are handled through a pointer to their storage, slices as a
+    // {pointer, i32 length} value
+    llvm::Value *declare_array(VariableDecl &node);
+    void copy_array(llvm::Value *destination, llvm::Value *source, Type type);
+    llvm::Value *element_address(Index &node);
+    // continues in a new block if index < length, traps otherwise
+    void check_bounds(llvm::Value *index, llvm::Value *length);
+    llvm::Value *length_of(llvm::Value *value, Type type);
+    llvm::Value *data_pointer(llvm::Value *value, Type type);
+    llvm::Value *make_slice(llvm::Value *data, llvm::Value *length, Type type);
+    // an array where a slice of it is expected becomes one, other values stay
+    llvm::Value *coerce(llvm::Value *value, Type from, Type to);
+    // "[]T(n)", n zeroed elements on the heap
+    llvm::Value *allocate_slice(llvm::Value *count, Type countType, Type type);
 
 public:
-    static std::unique_ptr<llvm::LLVMContext> context;
-    static std::unique_ptr<llvm::Module> module;
-
-    static std::unique_ptr<llvm::FunctionPassManager> theFPM;
-    static std::unique_ptr<llvm::LoopAnalysisManager> theLAM;
-    static std::unique_ptr<llvm::FunctionAnalysisManager> theFAM;
-    static std::unique_ptr<llvm::CGSCCAnalysisManager> theCGAM;
-    static std::unique_ptr<llvm::ModuleAnalysisManager> theMAM;
-    static std::unique_ptr<llvm::PassInstrumentationCallbacks> thePIC;
-    static std::unique_ptr<llvm::StandardInstrumentations> theSI;
-
-    CodegenVisitor();
+    explicit CodegenVisitor(const std::string &moduleName = "main", const CodegenOptions &options = {});
     ~CodegenVisitor();
 
+    llvm::Module &get_module() { return *module; }
+    llvm::TargetMachine &get_target_machine() { return *targetMachine; }
+
+    // hands the module and its context over, e.g. to the JIT. Nothing can be
+    // generated afterwards.
+    std::unique_ptr<llvm::Module> take_module() { return std::move(module); }
+    std::unique_ptr<llvm::LLVMContext> take_context() { return std::move(context); }
+
+    // function for the prototype, created on first use
+    llvm::Function *declare(Prototype &node);
+
+    // calls to functions that weren't declared up front are declared from
+    // the table instead of failing
+    void declare_on_demand(const PrototypeTable &prototypes) { calleePrototypes = &prototypes; }
+
+    // runs the default pipeline for the -O level over the whole module, the
+    // LTO pre-link one with -flto
+    void optimize();
+
+    // an object file, or bitcode with -flto
     bool write_to_file(const std::string &path);
 
 
-    void visit(Parameter &node) override;
+    llvm::Value *visit(Parameter &node);
 
     // Declaration Nodes
-    void visit(Prototype &node) override;
-    void visit(Definition &node) override;
+    llvm::Value *visit(Prototype &node);
+    llvm::Value *visit(Definition &node);
 
     // Statement Nodes
-    void visit(VariableDecl &node) override;
-    void visit(Assignment &node) override;
-    void visit(Block &node) override;
-    void visit(If &node) override;
-    void visit(While &node) override;
-    void visit(Return &node) override;
-    void visit(ExprStatement &node) override;
+    llvm::Value *visit(VariableDecl &node);
+    llvm::Value *visit(Assignment &node);
+    llvm::Value *visit(Block &node);
+    llvm::Value *visit(If &node);
+    llvm::Value *visit(While &node);
+    llvm::Value *visit(Return &node);
+    llvm::Value *visit(ExprStatement &node);
     
     // Expression Nodes
-    void visit(Variable &node) override;
-    void visit(CallExpr &node) override;
-    void visit(BinaryOp &node) override;
-    void visit(UnaryOp &node) override;
+    llvm::Value *visit(Variable &node);
+    llvm::Value *visit(CallExpr &node);
+    llvm::Value *visit(BinaryOp &node);
+    llvm::Value *visit(UnaryOp &node);
+    llvm::Value *visit(Index &node);
 
     // Literal Nodes
-    void visit(Number &node) override;
-    void visit(String &node) override;
-    void visit(Boolean &node) override;
+    llvm::Value *visit(Number &node);
+    llvm::Value *visit(String &node);
+    llvm::Value *visit(Boolean &node);
+    llvm::Value *visit(ArrayLiteral &node);
 };
 
 
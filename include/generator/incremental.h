@@ -0,0 +1,42 @@
+#ifndef GENERATOR_INCREMENTAL_H
+#define GENERATOR_INCREMENTAL_H
+
+#include <span>
+#include <string>
+#include <vector>
+
+#include "cache.h"
+#include "generator/base.h"
+#include "lexer/token.h"
+
+
+// Fingerprint of a definition: its tokens, which leave out comments, and the
+// signatures of the functions it calls. Nothing is inlined across objects in
+// incremental builds, so a callee's body can change without touching it.
+// `salt` covers everything else the object depends on, e.g. the target.
+std::string fingerprint_definition(
+    Definition &definition,
+    std::span<const Token> tokens,
+    const PrototypeTable &prototypes,
+    const std::string &salt);
+
+struct IncrementalObjects
+{
+    std::vector<std::string> objectPaths;
+    size_t reused = 0;
+};
+
+// Generates every definition into its own object in `directory`, named after
+// the function. Objects of definitions whose fingerprint is in the cache are
+// copied out of it, only the rest are generated, on up to `jobs` threads, and
+// then stored. `tokens` holds the tokens of each declaration.
+IncrementalObjects generate_incremental(
+    std::span<Declaration *> declarations,
+    std::span<const std::span<const Token>> tokens,
+    CompileCache &cache,
+    const std::string &directory,
+    const std::string &salt,
+    unsigned jobs,
+    const CodegenOptions &options = {});
+
+#endif
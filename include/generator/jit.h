@@ -0,0 +1,73 @@
+#ifndef GENERATOR_JIT_H
+#define GENERATOR_JIT_H
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "llvm/ExecutionEngine/Orc/IndirectionUtils.h"
+#include "llvm/ExecutionEngine/Orc/IRCompileLayer.h"
+#include "llvm/ExecutionEngine/Orc/LazyReexports.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+
+#include "generator/base.h"
+
+
+// Runs a program in this process through ORC. Every function is generated and
+// compiled on its first call, at -O0 and with a call counter. After `hotCalls`
+// calls it is generated again at the requested -O level and its stub is
+// pointed at the new code. Functions the program only declares, e.g. printf,
+// are resolved from the host process.
+class JIT
+{
+public:
+    static constexpr unsigned DEFAULT_HOT_CALLS = 100;
+
+    // the AST has to outlive the JIT
+    JIT(std::span<Declaration *> program, const CodegenOptions &options, unsigned hotCalls = DEFAULT_HOT_CALLS);
+
+    // finds `main` and compiles it, so it is ready to run. Throws unless it
+    // takes no parameters and returns int or nothing.
+    void lookup_main();
+
+    // calls `main` and returns its exit code, 0 if it returns nothing
+    int run_main();
+
+    size_t compiled_count() const { return compiled; }
+    size_t optimized_count() const { return optimized; }
+    size_t function_count() const { return definitions.size(); }
+
+private:
+    class FunctionUnit;
+
+    CodegenOptions options;
+    unsigned hotCalls;
+    PrototypeTable prototypes;
+    std::vector<Definition *> definitions;
+
+    std::unique_ptr<llvm::orc::LLJIT> jit;
+    // function bodies, named "<name>.tier0" and "<name>.tier1". The main
+    // dylib only has a stub for each function, so every call can be redirected.
+    llvm::orc::JITDylib *bodies = nullptr;
+    std::unique_ptr<llvm::orc::LazyCallThroughManager> callThrough;
+    std::unique_ptr<llvm::orc::IndirectStubsManager> stubs;
+
+    // tier 1 gets the full backend, tier 0 goes through LLJIT's own fast one
+    std::unique_ptr<llvm::TargetMachine> optimizingMachine;
+    std::unique_ptr<llvm::orc::IRCompileLayer> optimizingLayer;
+
+    llvm::orc::ExecutorAddr mainAddress;
+    bool mainReturnsVoid = false;
+
+    size_t compiled = 0;
+    size_t optimized = 0;
+
+    llvm::orc::ThreadSafeModule generate(size_t index, bool optimize);
+    void count_calls(llvm::Function &body, size_t index);
+
+    // called by tier 0 code once a function is hot
+    static void tier_up(JIT *self, uint32_t index);
+};
+
+#endif
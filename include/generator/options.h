@@ -0,0 +1,62 @@
+#ifndef GENERATOR_OPTIONS_H
+#define GENERATOR_OPTIONS_H
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+
+enum class OptLevel
+{
+    O0,
+    O1,
+    O2,
+    O3,
+    Os,
+    Oz
+};
+
+// level for the part after "-O", e.g. "2" or "s"
+constexpr std::optional<OptLevel> parse_opt_level(std::string_view name)
+{
+    if (name == "0") return OptLevel::O0;
+    if (name == "1") return OptLevel::O1;
+    if (name == "2") return OptLevel::O2;
+    if (name == "3") return OptLevel::O3;
+    if (name == "s") return OptLevel::Os;
+    if (name == "z") return OptLevel::Oz;
+
+    return std::nullopt;
+}
+
+enum class LTOMode
+{
+    None,
+    Thin,
+    Full
+};
+
+struct CodegenOptions
+{
+    OptLevel optLevel = OptLevel::O2;
+
+    // a CPU name such as "skylake", or "native" for the host CPU and all of
+    // its features
+    std::string cpu = "generic";
+    // "+avx2,-bmi2,..." applied on top of the features the CPU implies
+    std::string features;
+
+    // with link time optimization objects are LLVM bitcode, which the linker
+    // optimizes and compiles as a whole
+    LTOMode lto = LTOMode::None;
+
+    // lets floating point math be reassociated and approximated like with
+    // -ffast-math in C, assuming there are no NaNs, infinities or signed zeros
+    bool fastMath = false;
+
+    // indexing checks the index against the length and traps when it is out
+    // of bounds
+    bool boundsCheck = true;
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef GENERATOR_PARALLEL_H
+#define GENERATOR_PARALLEL_H
+
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "generator/base.h"
+
+
+// One slice of the program's function definitions, generated into its own
+// module and written to its own object file.
+struct Partition
+{
+    std::unique_ptr<CodegenVisitor> generator;
+    std::string objectPath;
+};
+
+// "<objectStem>.o" for a single partition, "<objectStem>.<index>.o" otherwise
+std::string partition_object_path(const std::string &objectStem, size_t index, size_t count);
+
+// Splits the definitions into up to `jobs` contiguous partitions and generates
+// them on separate threads. Every partition declares all prototypes first, so
+// calls into other partitions are left for the linker to resolve. Each module
+// is optimized on its own, so only functions in the same partition can be
+// inlined into each other. Objects are named by partition_object_path.
+std::vector<Partition> generate_partitions(
+    std::span<Declaration *> declarations,
+    const std::string &objectStem,
+    unsigned jobs,
+    const CodegenOptions &options = {});
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef INTERFACE_H
+#define INTERFACE_H
+
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ast.h"
+
+
+// A translation unit's interface: the signatures of the functions it defines,
+// one per line, e.g. "fn gcd 0 0 2 a 0 b 0" for name, return type, varargs,
+// then each parameter's name and type, a slice of ints is "[]0". Other units
+// import it in place of parsing the unit's source. Default values aren't part
+// of it, so callers in other units pass every argument. Throws if a parameter's
+// type isn't known, see infer_parameter_types.
+std::string write_interface(std::span<ast::Declaration *> declarations);
+
+// Extern prototypes for the functions of the interface, allocated in the
+// context. Interns the names, so it can't run alongside the lexer. Throws on
+// malformed input.
+std::vector<ast::Prototype *> read_interface(std::string_view text, ast::Context &context);
+
+#endif
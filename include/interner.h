@@ -0,0 +1,70 @@
+#ifndef INTERNER_H
+#define INTERNER_H
+
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "arena.h"
+
+
+// Handle to an interned identifier. Equal names always get the same id, so
+// comparing and hashing identifiers never touches the text.
+struct Identifier
+{
+    uint32_t id = 0;
+
+    std::string_view str() const;
+
+    bool operator==(const Identifier &other) const = default;
+
+    friend std::ostream &operator<<(std::ostream &out, const Identifier &obj)
+    {
+        return out << obj.str();
+    }
+};
+
+namespace std
+{
+    template <>
+    struct hash<Identifier>
+    {
+        size_t operator()(const Identifier &identifier) const noexcept {
+            return identifier.id;
+        }
+    };
+}
+
+
+// Names the compiler checks for, interned up front so they compare by id
+namespace builtin
+{
+    inline constexpr Identifier len{1};
+    inline constexpr Identifier main{2};
+}
+
+
+// Maps every distinct identifier of the compilation to a dense id. Id 0 is
+// the empty name, which is what a default constructed Identifier refers to,
+// and the names in `builtin` follow it.
+class Interner
+{
+    Arena storage;
+    std::unordered_map<std::string_view, uint32_t> ids;
+    std::vector<std::string_view> names;
+
+public:
+    Interner();
+    Interner(const Interner &) = delete;
+    Interner &operator=(const Interner &) = delete;
+
+    static Interner &global();
+
+    Identifier intern(std::string_view name);
+    std::string_view name(Identifier identifier) const { return names[identifier.id]; }
+    size_t size() const { return names.size(); }
+};
+
+#endif
@@ -2,27 +2,27 @@
 #define LEXER_BASE_H
 
 #include <memory>
+#include <string_view>
 #include <vector>
 
+#include "arena.h"
+#include "lexer/charclass.h"
 #include "lexer/token.h"
+#include "source.h"
 
 
-// valid identifiers start with a-zA-Z_
-bool is_valid_identifier_start(char character);
-
-// valid identifiers contain a-zA-Z0-9_
-bool is_valid_identifier_body(char character);
-
-// valid numbers contain 0-9
-bool is_valid_number(char character);
-
 bool has_even_number_of_quotations(const std::string& str);
 
 
+// Tokens point straight into `source`, which the lexer does not copy, so the
+// buffer has to outlive them. Only string literals containing escape
+// sequences get decoded into the lexer's own arena.
 class Lexer
 {
-    const std::string source;
+    SourceBuffer *input = nullptr;
+    std::string_view source;
     std::vector<Token> tokens;
+    Arena strings;
     size_t start = 0;
     size_t current = 0;
     size_t line = 1;
@@ -34,13 +34,19 @@ class Lexer
     const char prev() const;
     const char next() const;
     const char advance();
+    void advance_to(const char *position);  // skips a run that contains no newlines
 
     bool check(char expected) const;
     bool match(char expected);
 
+    void scan_available(bool complete);
+
 public:
-    explicit Lexer(const std::string &source) : source(source) {}
-    std::vector<Token> tokenize();
+    explicit Lexer(std::string_view source) : source(source) {}
+    explicit Lexer(std::string &&source) = delete;
+    explicit Lexer(SourceBuffer &input) : input(&input), source(input.view()) {}
+
+    const std::vector<Token> &tokenize();
 
     void skip_empty();  // handles whitespaces, newlines and comments
     void scan_token();
@@ -48,7 +54,7 @@ public:
     void scan_string();
     void scan_number();
     void add_token(TokenType type);
-    void add_token(TokenType type, const std::string &text);
+    void add_token(TokenType type, std::string_view text);
 };
 
 #endif
\ No newline at end of file
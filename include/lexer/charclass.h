@@ -0,0 +1,51 @@
+#ifndef LEXER_CHARCLASS_H
+#define LEXER_CHARCLASS_H
+
+#include <array>
+#include <cstdint>
+
+
+enum CharClass : uint8_t
+{
+    cc_space = 1 << 0,            // ' ', '\t'
+    cc_newline = 1 << 1,          // '\r', '\n'
+    cc_identifier_start = 1 << 2, // a-zA-Z_
+    cc_identifier_body = 1 << 3,  // a-zA-Z0-9_
+    cc_digit = 1 << 4             // 0-9
+};
+
+constexpr std::array<uint8_t, 256> make_char_class_table()
+{
+    std::array<uint8_t, 256> table{};
+
+    table[' '] = table['\t'] = cc_space;
+    table['\r'] = table['\n'] = cc_newline;
+
+    for (int c = 'a'; c <= 'z'; ++c)
+        table[c] = table[c - 'a' + 'A'] = cc_identifier_start | cc_identifier_body;
+
+    table['_'] = cc_identifier_start | cc_identifier_body;
+
+    for (int c = '0'; c <= '9'; ++c)
+        table[c] = cc_digit | cc_identifier_body;
+
+    return table;
+}
+
+inline constexpr std::array<uint8_t, 256> char_class_table = make_char_class_table();
+
+constexpr bool has_char_class(char character, uint8_t classes)
+{
+    return char_class_table[static_cast<unsigned char>(character)] & classes;
+}
+
+// valid identifiers start with a-zA-Z_
+constexpr bool is_valid_identifier_start(char character) { return has_char_class(character, cc_identifier_start); }
+
+// valid identifiers contain a-zA-Z0-9_
+constexpr bool is_valid_identifier_body(char character) { return has_char_class(character, cc_identifier_body); }
+
+// valid numbers contain 0-9
+constexpr bool is_valid_number(char character) { return has_char_class(character, cc_digit); }
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef LEXER_KEYWORDS_H
+#define LEXER_KEYWORDS_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#include "lexer/token.h"
+
+
+// Keywords from KEYWORD_MAPPINGS, found through a perfect hash built at compile
+// time. The hash only looks at the length and the first and last byte, so a
+// lookup costs one table load and at most one comparison.
+namespace keywords
+{
+    struct Keyword
+    {
+        std::string_view text;
+        TokenType type;
+    };
+
+#define ROW(tok, str) {str, tok},
+    inline constexpr Keyword table[] = {
+        KEYWORD_MAPPINGS};
+#undef ROW
+
+    inline constexpr size_t SLOT_COUNT = 128;
+
+    struct Hash
+    {
+        uint32_t first = 0;
+        uint32_t last = 0;
+
+        constexpr size_t operator()(std::string_view text) const
+        {
+            return (static_cast<unsigned char>(text.front()) * first +
+                    static_cast<unsigned char>(text.back()) * last +
+                    text.size()) % SLOT_COUNT;
+        }
+    };
+
+    // smallest multipliers that give every keyword its own slot
+    constexpr Hash find_hash()
+    {
+        for (uint32_t first = 1; first < SLOT_COUNT; ++first)
+        {
+            for (uint32_t last = 1; last < SLOT_COUNT; ++last)
+            {
+                Hash hash{first, last};
+                std::array<bool, SLOT_COUNT> used{};
+                bool collision = false;
+
+                for (const auto &keyword : table)
+                {
+                    size_t slot = hash(keyword.text);
+                    collision = collision || used[slot];
+                    used[slot] = true;
+                }
+
+                if (!collision)
+                    return hash;
+            }
+        }
+
+        return Hash{};
+    }
+
+    inline constexpr Hash hash = find_hash();
+    static_assert(hash.first != 0, "no perfect hash for KEYWORD_MAPPINGS, increase SLOT_COUNT");
+
+    constexpr std::array<int8_t, SLOT_COUNT> make_slots()
+    {
+        std::array<int8_t, SLOT_COUNT> slots{};
+        slots.fill(-1);
+
+        for (size_t i = 0; i < std::size(table); ++i)
+            slots[hash(table[i].text)] = static_cast<int8_t>(i);
+
+        return slots;
+    }
+
+    inline constexpr std::array<int8_t, SLOT_COUNT> slots = make_slots();
+
+    constexpr size_t make_max_length()
+    {
+        size_t length = 0;
+        for (const auto &keyword : table)
+            length = std::max(length, keyword.text.size());
+
+        return length;
+    }
+
+    inline constexpr size_t max_length = make_max_length();
+}
+
+// keyword token for the lexeme, tok_identifier if it isn't one
+constexpr TokenType lookup_keyword(std::string_view lexeme)
+{
+    if (lexeme.empty() || lexeme.size() > keywords::max_length)
+        return tok_identifier;
+
+    int8_t index = keywords::slots[keywords::hash(lexeme)];
+
+    if (index < 0 || keywords::table[index].text != lexeme)
+        return tok_identifier;
+
+    return keywords::table[index].type;
+}
+
+static_assert(lookup_keyword("while") == tok_while);
+static_assert(lookup_keyword("whale") == tok_identifier);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef LEXER_SIMD_H
+#define LEXER_SIMD_H
+
+#include <string_view>
+
+
+// Vectorized scanning of the long runs in the lexer. Every function returns a
+// pointer to the first byte in [begin, end) that ends the run, or `end`.
+namespace simd
+{
+    enum class Level
+    {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    // best level supported by the CPU, detected through CPUID
+    Level detect();
+
+    Level level();
+    void set_level(Level level);
+
+    std::string_view level_name(Level level);
+
+    // ' ' and '\t'
+    const char *skip_spaces(const char *begin, const char *end);
+
+    // a-zA-Z0-9_
+    const char *skip_identifier(const char *begin, const char *end);
+
+    // stops at '\n', for comment bodies
+    const char *find_newline(const char *begin, const char *end);
+
+    // stops at '"', '\\' or '\n', for string literal bodies
+    const char *find_string_special(const char *begin, const char *end);
+}
+
+#endif
@@ -2,9 +2,11 @@
 #define LEXER_TOKEN_H
 
 #include <string>
+#include <string_view>
 #include <ostream>
 #include <unordered_map>
 
+#include "interner.h"
 #include "operators.h"
 #include "utils.h"
 
@@ -21,6 +23,8 @@ enum TokenType
     tok_close_paren,
     tok_open_brace,
     tok_close_brace,
+    tok_open_bracket,
+    tok_close_bracket,
 
     tok_colon,
     tok_arrow,
@@ -62,16 +66,25 @@ enum TokenType
 
     // keywords
     tok_let,
+    tok_const,
     tok_int,
     tok_bool,
     tok_str,
+    tok_i32,
+    tok_i64,
+    tok_u32,
+    tok_u64,
+    tok_f32,
+    tok_f64,
     // .
     tok_fn,
     tok_return,
     tok_if,
     tok_else,
     tok_while,
-    tok_extern
+    tok_extern,
+    tok_likely,
+    tok_unlikely
 };
 
 #define TOKEN_TO_STR_MAPPINGS                     \
@@ -83,6 +96,8 @@ enum TokenType
     ROW(tok_close_paren, "tok_close_paren")       \
     ROW(tok_open_brace, "tok_open_brace")         \
     ROW(tok_close_brace, "tok_close_brace")       \
+    ROW(tok_open_bracket, "tok_open_bracket")     \
+    ROW(tok_close_bracket, "tok_close_bracket")   \
     ROW(tok_colon, "tok_colon")                   \
     ROW(tok_arrow, "tok_arrow")                   \
     ROW(tok_varargs, "tok_varargs")               \
@@ -112,15 +127,24 @@ enum TokenType
     ROW(tok_eq, "tok_eq")                         \
     ROW(tok_neq, "tok_neq")                       \
     ROW(tok_let, "tok_let")                       \
+    ROW(tok_const, "tok_const")                   \
     ROW(tok_int, "tok_int")                       \
     ROW(tok_bool, "tok_bool")                     \
     ROW(tok_str, "tok_str")                       \
+    ROW(tok_i32, "tok_i32")                       \
+    ROW(tok_i64, "tok_i64")                       \
+    ROW(tok_u32, "tok_u32")                       \
+    ROW(tok_u64, "tok_u64")                       \
+    ROW(tok_f32, "tok_f32")                       \
+    ROW(tok_f64, "tok_f64")                       \
     ROW(tok_fn, "tok_fn")                         \
     ROW(tok_return, "tok_return")                 \
     ROW(tok_if, "tok_if")                         \
     ROW(tok_else, "tok_else")                     \
     ROW(tok_while, "tok_while")                   \
-    ROW(tok_extern, "tok_extern")
+    ROW(tok_extern, "tok_extern")                 \
+    ROW(tok_likely, "tok_likely")                 \
+    ROW(tok_unlikely, "tok_unlikely")
 
 #define KEYWORD_MAPPINGS      \
     ROW(tok_true, "true")     \
@@ -129,15 +153,24 @@ enum TokenType
     ROW(tok_and, "and")       \
     ROW(tok_or, "or")         \
     ROW(tok_let, "let")       \
+    ROW(tok_const, "const")   \
     ROW(tok_int, "int")       \
     ROW(tok_bool, "bool")     \
     ROW(tok_str, "str")       \
+    ROW(tok_i32, "i32")       \
+    ROW(tok_i64, "i64")       \
+    ROW(tok_u32, "u32")       \
+    ROW(tok_u64, "u64")       \
+    ROW(tok_f32, "f32")       \
+    ROW(tok_f64, "f64")       \
     ROW(tok_fn, "fn")         \
     ROW(tok_return, "return") \
     ROW(tok_if, "if")         \
     ROW(tok_else, "else")     \
     ROW(tok_while, "while")   \
-    ROW(tok_extern, "extern")
+    ROW(tok_extern, "extern") \
+    ROW(tok_likely, "likely") \
+    ROW(tok_unlikely, "unlikely")
 
 #define BINARY_OPERATOR_MAPPINGS       \
     ROW(tok_plus, binop_add)           \
@@ -174,11 +207,6 @@ const std::unordered_map<std::string, TokenType> str_to_token = {
     TOKEN_TO_STR_MAPPINGS};
 #undef ROW
 
-#define ROW(tok, str) {str, tok},
-const std::unordered_map<std::string, TokenType> keyword_to_token = {
-    KEYWORD_MAPPINGS};
-#undef ROW
-
 #define ROW(tok, op) {tok, op},
 const std::unordered_map<TokenType, BinaryOpType> token_to_binary_op = {
     BINARY_OPERATOR_MAPPINGS};
@@ -203,11 +231,12 @@ struct Token
 {
     TokenType type;
     Position position;
-    std::string lexeme;
+    std::string_view lexeme;
+    Identifier identifier;  // only set for tok_identifier
 
 public:
     Token() = default;
-    Token(TokenType type, Position position, std::string lexeme);
+    Token(TokenType type, Position position, std::string_view lexeme);
 
     friend std::ostream &operator<<(std::ostream &out, const Token &obj)
     {
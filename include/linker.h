@@ -0,0 +1,35 @@
+#ifndef LINKER_H
+#define LINKER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+struct LinkOptions
+{
+    // searched for the C runtime objects and libraries before the usual
+    // system locations
+    std::vector<std::string> libraryPaths;
+
+    // link through the `gcc` driver instead of the built-in lld
+    bool systemLinker = false;
+
+    // the objects are bitcode, optimized at `ltoOptLevel` (0 to 3) by up to
+    // `ltoJobs` ThinLTO backends. Their results are cached in
+    // `ltoCacheDirectory` unless it is empty. Only the built-in lld can do this.
+    bool lto = false;
+    unsigned ltoOptLevel = 2;
+    unsigned ltoJobs = 1;
+    std::string ltoCacheDirectory;
+    uint64_t ltoCacheSize = 0;
+};
+
+// Links the objects and the C library into a position independent executable.
+// Errors are printed, returns false if linking failed.
+bool link_executable(
+    const std::vector<std::string> &objects,
+    const std::string &output,
+    const LinkOptions &options = {});
+
+#endif
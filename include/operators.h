@@ -1,6 +1,8 @@
 #ifndef OPERATORS_H
 #define OPERATORS_H
 
+#include <cstdint>
+#include <string>
 #include <unordered_map>
 
 enum BinaryOpType
@@ -13,6 +15,7 @@ enum BinaryOpType
     binop_mul,
     binop_div,
     binop_mod,
+    // "x ** n", integers wrap like repeated multiplication
     binop_exp,
 
     // Logical
@@ -40,9 +43,14 @@ enum UnaryOpType
     unary_add,
     unary_sub,
     unary_not,
-    unary_bit_not
+    unary_bit_not,
+    // "f64(x)", the target type is the node's type
+    unary_convert
 };
 
+// "x ** n" with a constant n up to this size is unrolled into multiplications
+constexpr int64_t MAX_UNROLLED_POWER = 64;
+
 #define BINARY_OP_TO_STR_MAPPINGS \
     ROW(binop_add, "Add") \
     ROW(binop_sub, "Sub") \
@@ -66,7 +74,8 @@ enum UnaryOpType
     ROW(unary_add, "Pos") \
     ROW(unary_sub, "Neg") \
     ROW(unary_not, "Not") \
-    ROW(unary_bit_not, "bNot")
+    ROW(unary_bit_not, "bNot") \
+    ROW(unary_convert, "Convert")
 
 #define ROW(op, str) { op, str },
 const std::unordered_map<BinaryOpType, std::string> binop_to_str = {
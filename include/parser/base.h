@@ -1,7 +1,7 @@
 #ifndef PARSER_BASE_H
 #define PARSER_BASE_H
 
-#include <memory>
+#include <span>
 #include <vector>
 
 #include "ast.h"
@@ -12,8 +12,19 @@ using namespace ast;
 class Parser
 {
     const std::vector<Token>& tokens;
+    Context &context;
     size_t idx = 0;
 
+    // items of the lists currently being parsed, nested lists share it as a stack
+    std::vector<ASTNode *> scratch;
+
+    // tokens of each top-level declaration, in order
+    std::vector<std::span<const Token>> declarationTokens;
+
+    // moves the scratch items pushed since `mark` into a list in the context
+    template <class T>
+    std::span<T *> collect(size_t mark);
+
     bool valid_index() const;
 
     const Token& peek() const;
@@ -26,31 +37,40 @@ class Parser
     const Token& consume(TokenType expected, const std::string& error);
 
 public:
-    explicit Parser(const std::vector<Token>& tokens) : tokens(tokens) {}
-    std::vector<std::unique_ptr<Declaration>> parse();
+    Parser(const std::vector<Token>& tokens, Context &context) : tokens(tokens), context(context) {}
+    std::span<Declaration *> parse();
+
+    // the tokens each declaration returned by parse() was parsed from
+    const std::vector<std::span<const Token>> &declaration_tokens() const { return declarationTokens; }
 
     // Expressions
-    std::unique_ptr<Expr> parse_expression(int precedence = 0);
-    std::unique_ptr<Expr> parse_primary();
-    std::unique_ptr<Expr> parse_unary_expr();
-    std::unique_ptr<CallExpr> parse_call_expr();
-    std::unique_ptr<Variable> parse_variable();
+    Expr *parse_expression(int precedence = 0);
+    Expr *parse_primary();
+    Expr *parse_unary_expr();
+    Expr *parse_postfix_expr();
+    CallExpr *parse_call_expr();
+    Variable *parse_variable();
     
     // Statements
-    std::unique_ptr<Statement> parse_statement();
-    std::unique_ptr<Return> parse_return_stmt();
-    std::unique_ptr<If> parse_if_stmt();
-    std::unique_ptr<While> parse_while_stmt();
-    std::unique_ptr<Block> parse_block();
-    std::unique_ptr<VariableDecl> parse_variable_decl();
-    std::unique_ptr<Assignment> parse_assignment();
+    Statement *parse_statement();
+    Return *parse_return_stmt();
+    If *parse_if_stmt();
+    While *parse_while_stmt();
+    // an optional "likely" or "unlikely" before a condition
+    BranchHint parse_branch_hint();
+    Block *parse_block();
+    VariableDecl *parse_variable_decl();
+    Assignment *parse_assignment(Expr *target);
     
+    // a builtin type, "[T; N]", "[T; SIZE]" or "[]T", throws `error` if there is none
+    Type parse_type(const std::string &error);
+
     // Declarations
-    std::unique_ptr<Prototype> parse_prototype();
-    std::unique_ptr<Parameter> parse_parameter();
-    std::unique_ptr<Declaration> parse_extern();
-    std::unique_ptr<Declaration> parse_function();
-    std::unique_ptr<Declaration> parse_declaration();
+    Prototype *parse_prototype();
+    Parameter *parse_parameter();
+    Declaration *parse_extern();
+    Declaration *parse_function();
+    Declaration *parse_declaration();
 };
 
 
@@ -42,11 +42,13 @@ public:
     void visit(CallExpr &node) override;
     void visit(BinaryOp &node) override;
     void visit(UnaryOp &node) override;
+    void visit(Index &node) override;
 
     // Literal Nodes
     void visit(Number &node) override;
     void visit(String &node) override;
     void visit(Boolean &node) override;
+    void visit(ArrayLiteral &node) override;
 };
 
 #endif
\ No newline at end of file
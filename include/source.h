@@ -0,0 +1,61 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+
+// Read-only bytes of a source file. The view only ever grows and its data
+// pointer never moves, so tokens pointing into it stay valid.
+class SourceBuffer
+{
+protected:
+    const char *data = nullptr;
+    size_t size = 0;
+
+public:
+    // "-" reads from stdin
+    static std::unique_ptr<SourceBuffer> open(const std::string &path);
+    virtual ~SourceBuffer() = default;
+
+    std::string_view view() const { return std::string_view(data, size); }
+
+    // makes more of the input available, returns false once it's all there
+    virtual bool fill() = 0;
+    virtual bool complete() const = 0;
+};
+
+// Regular files, mapped in full. Pages are only read in as the lexer touches them.
+class MappedSource : public SourceBuffer
+{
+public:
+    MappedSource(int fd, size_t length);
+    ~MappedSource() override;
+
+    bool fill() override { return false; }
+    bool complete() const override { return true; }
+};
+
+// Pipes, stdin and anything else that can't be mapped. Chunks are read into a
+// reserved address range instead of a growable buffer, so nothing gets moved.
+class StreamedSource : public SourceBuffer
+{
+    static constexpr size_t CHUNK_SIZE = 256 * 1024;
+
+    int fd;
+    bool ownsFd;
+    bool eof = false;
+    char *region = nullptr;
+    size_t reserved = 0;
+
+public:
+    StreamedSource(int fd, bool ownsFd);
+    ~StreamedSource() override;
+
+    bool fill() override;
+    bool complete() const override { return eof; }
+};
+
+#endif
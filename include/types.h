@@ -1,6 +1,11 @@
 #ifndef TYPES_H
 #define TYPES_H
 
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "interner.h"
 #include "lexer/token.h"
 
 enum class Type
@@ -9,9 +14,50 @@ enum class Type
     Int,
     Bool,
     String,
-    Void
+    Void,
+    I64,
+    U32,
+    U64,
+    F32,
+    F64
 };
 
+constexpr bool is_integer(Type type)
+{
+    return type == Type::Int || type == Type::I64 || type == Type::U32 || type == Type::U64;
+}
+
+constexpr bool is_float(Type type) { return type == Type::F32 || type == Type::F64; }
+constexpr bool is_numeric(Type type) { return is_integer(type) || is_float(type); }
+constexpr bool is_unsigned(Type type) { return type == Type::U32 || type == Type::U64; }
+constexpr bool is_scalar(Type type) { return type == Type::Bool || is_numeric(type); }
+
+// Arrays and slices are interned like identifiers: every distinct one is a
+// Type past the builtin ones, which indexes a global table of its element
+// type and length. Any thread can add to it, and reading it takes no lock.
+constexpr int first_composite_type = 256;
+
+constexpr bool is_composite(Type type) { return static_cast<int>(type) >= first_composite_type; }
+
+// "[element; length]", stored inline
+Type array_type(Type element, uint32_t length);
+// "[]element", a pointer to the elements and their count
+Type slice_type(Type element);
+// "[element; N]" with the constant N as its length, until the analyzer
+// replaces it with the array of N's value
+Type named_array_type(Type element, Identifier length);
+
+// arrays with a named length count as arrays
+bool is_array(Type type);
+bool is_slice(Type type);
+bool has_named_length(Type type);
+Type element_type(Type type);
+uint32_t array_length(Type type);
+Identifier length_name(Type type);
+
+// the type as it is written in the source, e.g. "[]f64"
+std::string type_name(Type type);
+
 namespace std
 {
     template <>
@@ -29,12 +75,23 @@ namespace std
     ROW(Type::Int, "int")     \
     ROW(Type::Bool, "bool")   \
     ROW(Type::String, "str")  \
-    ROW(Type::Void, "")
+    ROW(Type::Void, "")       \
+    ROW(Type::I64, "i64")     \
+    ROW(Type::U32, "u32")     \
+    ROW(Type::U64, "u64")     \
+    ROW(Type::F32, "f32")     \
+    ROW(Type::F64, "f64")
 
 #define TYPE_TOKEN_MAPPINGS   \
     ROW(Type::Int, tok_int)   \
     ROW(Type::Bool, tok_bool) \
-    ROW(Type::String, tok_str)
+    ROW(Type::String, tok_str) \
+    ROW(Type::Int, tok_i32)    \
+    ROW(Type::I64, tok_i64)    \
+    ROW(Type::U32, tok_u32)    \
+    ROW(Type::U64, tok_u64)    \
+    ROW(Type::F32, tok_f32)    \
+    ROW(Type::F64, tok_f64)
 
 #define ROW(type, str) {type, str},
 const std::unordered_map<Type, std::string> type_to_str = {
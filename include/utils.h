@@ -2,9 +2,8 @@
 #define UTILS_H
 
 #include <string>
+#include <string_view>
 
-std::string to_escaped_string(const std::string& str);
-
-std::string read_file(const std::string& path);
+std::string to_escaped_string(std::string_view str);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,51 @@
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+
+
+// Runs task(i) for every i in [0, count) on up to `jobs` threads, the calling
+// thread included. Items are handed out one at a time, so uneven items still
+// balance. If tasks throw, the exception of the lowest index is rethrown once
+// all threads are done, independent of scheduling.
+template <class F>
+void parallel_for(size_t count, unsigned jobs, F &&task)
+{
+    size_t threads = std::clamp<size_t>(jobs, 1, std::max<size_t>(count, 1));
+
+    std::atomic<size_t> next = 0;
+    std::vector<std::exception_ptr> errors(count);
+
+    auto work = [&] {
+        for (size_t i = next++; i < count; i = next++)
+        {
+            try
+            {
+                task(i);
+            }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threads; ++i)
+        workers.emplace_back(work);
+
+    work();
+
+    for (auto &worker : workers)
+        worker.join();
+
+    for (auto &error : errors)
+        if (error)
+            std::rethrow_exception(error);
+}
+
+#endif
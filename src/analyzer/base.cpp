@@ -1,89 +1,305 @@
+#include <cstdint>
 #include <format>
 
 #include "analyzer/base.h"
+#include "analyzer/constant.h"
+#include "analyzer/typing.h"
+#include "workers.h"
+
+namespace
+{
+    // Gives a numeric literal, possibly negated, the type its context expects
+    void convert_literal(Expr &expr, Type target, bool negated = false)
+    {
+        // "[1, 2]" as a [f64; 2] or a []f64
+        if (expr.kind == NodeKind::ArrayLiteral && is_composite(target))
+        {
+            auto &array = static_cast<ArrayLiteral &>(expr);
+            if (is_array(target) && array_length(target) != array.elements.size())
+                return;
+
+            Type element = element_type(target);
+            for (auto item : array.elements)
+            {
+                convert_literal(*item, element);
+                if (item->type != element)
+                    return;
+            }
+
+            array.type = array_type(element, array.elements.size());
+            return;
+        }
+
+        if (expr.type == target || !literal_converts(expr.type, target))
+            return;
+
+        if (expr.kind == NodeKind::Number)
+        {
+            auto &number = static_cast<Number &>(expr);
+
+            if (is_integer(number.type))
+            {
+                if (!integer_fits(number.value, target, negated))
+                    return;
+                if (is_float(target))
+                    number.real = static_cast<double>(number.value);
+            }
+
+            number.type = target;
+        }
+        else if (expr.kind == NodeKind::UnaryOp)
+        {
+            auto &unary = static_cast<UnaryOp &>(expr);
+
+            bool sign = unary.op == unary_add || (unary.op == unary_sub && !is_unsigned(target));
+            if (!sign)
+                return;
+
+            convert_literal(*unary.rhs, target, negated != (unary.op == unary_sub));
+            if (unary.rhs->type == target)
+                unary.type = target;
+        }
+    }
+
+    bool is_literal(const Expr &expr)
+    {
+        return expr.kind == NodeKind::Number || expr.kind == NodeKind::Boolean;
+    }
+
+    Constant constant_of(const Expr &literal)
+    {
+        if (literal.kind == NodeKind::Boolean)
+            return Constant{Type::Bool, static_cast<const Boolean &>(literal).value};
+
+        auto &number = static_cast<const Number &>(literal);
+        return Constant{number.type, number.value, number.real};
+    }
+
+    // an array of literals, which a constant table can be initialized with
+    bool is_table(const Expr &expr)
+    {
+        if (expr.kind != NodeKind::ArrayLiteral)
+            return false;
+
+        for (auto element : static_cast<const ArrayLiteral &>(expr).elements)
+            if (!is_literal(*element) && element->kind != NodeKind::String)
+                return false;
+
+        return true;
+    }
+
+    bool is_true(const Expr &literal)
+    {
+        return fold_unary(unary_convert, constant_of(literal), Type::Bool)->bits != 0;
+    }
+}
+
+
+Expr *AnalyzerVisitor::make_literal(const Constant &constant)
+{
+    if (constant.type == Type::Bool)
+        return nodes.make<Boolean>(constant.bits != 0);
+    if (is_float(constant.type))
+        return nodes.make<Number>(constant.real, constant.type);
+
+    return nodes.make<Number>(constant.bits, constant.type);
+}
+
+// Returns the literal the expression folds to, or the expression itself with
+// its operands folded
+Expr *AnalyzerVisitor::fold(Expr *expr)
+{
+    switch (expr->kind)
+    {
+    case NodeKind::Variable:
+    {
+        const VarSymbol *symbol = scopes.lookupVariable(static_cast<Variable *>(expr)->name);
+
+        if (symbol->value != nullptr && is_literal(*symbol->value))
+            return make_literal(constant_of(*symbol->value));
+
+        return expr;
+    }
+
+    case NodeKind::BinaryOp:
+    {
+        auto &node = static_cast<BinaryOp &>(*expr);
+        node.lhs = fold(node.lhs);
+        node.rhs = fold(node.rhs);
+
+        if (is_literal(*node.lhs) && is_literal(*node.rhs))
+            if (auto result = fold_binary(node.op, constant_of(*node.lhs), constant_of(*node.rhs)))
+                return make_literal(*result);
+
+        return expr;
+    }
+
+    case NodeKind::UnaryOp:
+    {
+        auto &node = static_cast<UnaryOp &>(*expr);
+        node.rhs = fold(node.rhs);
+
+        if (is_literal(*node.rhs))
+            if (auto result = fold_unary(node.op, constant_of(*node.rhs), node.type))
+                return make_literal(*result);
+
+        return expr;
+    }
+
+    case NodeKind::CallExpr:
+    {
+        auto &node = static_cast<CallExpr &>(*expr);
+
+        for (auto &arg : node.args)
+            arg = fold(arg);
+
+        // arrays have their length in their type
+        if (node.callee == builtin::len && node.args[0]->kind == NodeKind::Variable && is_array(node.args[0]->type))
+            return nodes.make<Number>(static_cast<uint64_t>(array_length(node.args[0]->type)), Type::Int);
+
+        return expr;
+    }
+
+    case NodeKind::Index:
+        return fold_index(static_cast<Index &>(*expr));
+
+    case NodeKind::ArrayLiteral:
+        for (auto &element : static_cast<ArrayLiteral &>(*expr).elements)
+            element = fold(element);
+
+        return expr;
+
+    default:
+        return expr;
+    }
+}
+
+Expr *AnalyzerVisitor::fold_index(Index &node)
+{
+    node.base = fold(node.base);
+    node.index = fold(node.index);
+
+    if (!is_literal(*node.index) || !is_array(node.base->type))
+        return &node;
+
+    // the generator leaves out the run time check for constant indices
+    Constant index = constant_of(*node.index);
+
+    if (index.bits >= array_length(node.base->type))
+    {
+        std::string value = is_unsigned(index.type) ? std::to_string(index.bits) : std::to_string(static_cast<int64_t>(index.bits));
+        throw std::runtime_error(std::format("Index {} is out of bounds for {}", value, type_name(node.base->type)));
+    }
+
+    // an element of a constant table
+    if (node.base->kind == NodeKind::Variable)
+    {
+        const VarSymbol *symbol = scopes.lookupVariable(static_cast<Variable *>(node.base)->name);
+
+        if (symbol->value != nullptr && symbol->value->kind == NodeKind::ArrayLiteral)
+        {
+            const Expr &element = *static_cast<const ArrayLiteral *>(symbol->value)->elements[index.bits];
+
+            if (is_literal(element))
+                return make_literal(constant_of(element));
+        }
+    }
+
+    return &node;
+}
+
+// "[T; SIZE]" becomes an array of the constant's value
+Type AnalyzerVisitor::resolve_length(Type type)
+{
+    if (!has_named_length(type))
+        return type;
+
+    Identifier name = length_name(type);
+    const VarSymbol *symbol = scopes.lookupVariable(name);
+
+    if (symbol == nullptr || symbol->isMutable || symbol->value == nullptr || !is_integer(symbol->value->type))
+        throw std::runtime_error(std::format("Array length '{}' has to be an integer constant", name.str()));
+
+    Constant length = constant_of(*symbol->value);
+    bool negative = !is_unsigned(length.type) && static_cast<int64_t>(length.bits) < 0;
+
+    if (negative || length.bits == 0 || length.bits > INT32_MAX)
+        throw std::runtime_error(std::format("Invalid array length '{}' of {}", name.str(), type_name(type)));
+
+    return array_type(element_type(type), static_cast<uint32_t>(length.bits));
+}
+
+// Constant tables are read-only, a slice of one could be written through
+void AnalyzerVisitor::check_view(const Expr &value, Type target)
+{
+    if (!is_slice(target) || !is_array(value.type) || value.kind != NodeKind::Variable)
+        return;
+
+    Identifier name = static_cast<const Variable &>(value).name;
+    const VarSymbol *symbol = scopes.lookupVariable(name);
+
+    if (symbol != nullptr && !symbol->isMutable)
+        throw std::runtime_error(std::format("Constant '{}' can't be used as a slice, copy it into a 'let' first", name.str()));
+}
+
 
 void AnalyzerVisitor::visit(Parameter &node)
 {
     if (node.init != nullptr)
     {
-        node.init->accept(*this);
+        dispatch(*node.init);
 
         if (node.type != Type::Unknown)
         {
-            if (node.type != node.init->type)
+            convert_literal(*node.init, node.type);
+
+            if (!assignable(node.init->type, node.type))
                 throw std::runtime_error("Type mismatch when initializing a parameter");
         }
         else
             node.type = node.init->type;
+
+        node.init = fold(node.init);
     }
 }
 
 // Declaration Nodes
 void AnalyzerVisitor::visit(Prototype &node)
 {
-    std::vector<ParamSymbol> args;
     bool seenInit = false;
 
     for (auto &arg : node.args)
     {
-        arg->accept(*this);
+        visit(*arg);
+
+        if (is_array(arg->type))
+            throw std::runtime_error(std::format("Array parameter '{}' has to be a slice, e.g. '[]{}'", arg->name.str(), type_name(element_type(arg->type))));
 
         if (arg->init != nullptr)
         {
             seenInit = true;
         }
         else if (seenInit)
-            throw std::runtime_error(std::format("Non-default parameter '{}' cannot follow a parameter with a default value", arg->name));
-
-        ParamSymbol paramSymbol;
-        paramSymbol.name = arg->name;
-        paramSymbol.type = arg->type;
-        paramSymbol.hasInit = arg->init != nullptr;
-
-        args.push_back(paramSymbol);
+            throw std::runtime_error(std::format("Non-default parameter '{}' cannot follow a parameter with a default value", arg->name.str()));
     }
 
-    FuncSymbol funcSymbol;
-    funcSymbol.name = node.name;
-    funcSymbol.retType = node.retType;
-    funcSymbol.args = std::move(args);
-    funcSymbol.isExtern = node.isExtern;
-    funcSymbol.isVarArg = node.isVarArg;
-    funcSymbol.isDefined = false;
+    if (is_array(node.retType))
+        throw std::runtime_error("Functions can't return arrays, only slices");
 
-    symbols->addFunction(funcSymbol);
+    // C functions return a bare pointer, without the length
+    if (node.isExtern && !node.isImported && is_slice(node.retType))
+        throw std::runtime_error("Extern functions can't return slices");
 }
 
 void AnalyzerVisitor::visit(Definition &node)
 {
-    node.type->accept(*this);
-
-    FuncSymbol *funcSymPtr = symbols->lookupFunction(node.type->name);
+    const FuncSymbol *funcSymPtr = functions.lookupFunction(node.type->name);
     currentFuncReturnType = funcSymPtr->retType;
-    
-    // missing return statement at the end of a function
-    if (dynamic_cast<Return*>(node.body->statements.back().get()) == nullptr)
-    {
-        if (currentFuncReturnType == Type::Void)
-        {
-            auto emptyReturnStmnt = std::make_unique<Return>(nullptr);
-            node.body->statements.push_back(std::move(emptyReturnStmnt));
-        }
-        // missing return statement from a typed function
-        else
-        {
-            // insert return 0 in the main function only
-            if (node.type->name == "main")
-            {
-                auto returnStmnt = std::make_unique<Return>(std::make_unique<Number>(0));
-                node.body->statements.push_back(std::move(returnStmnt));
-            }
-            else
-                throw std::runtime_error("Missing return statement in a non-void function");
-        }
-    }
-    
-    symbols->enterScope();
+
+    assigned.clear();
+    collect_assigned(*node.body, assigned);
+
+    scopes.enterScope();
 
     for (const auto &arg : funcSymPtr->args)
     {
@@ -93,89 +309,146 @@ void AnalyzerVisitor::visit(Definition &node)
         varSymbol.llvmValue = nullptr;
         varSymbol.isMutable = true;
 
-        symbols->addVariable(varSymbol);
+        scopes.addVariable(varSymbol);
     }
 
-    node.body->accept(*this);
-    symbols->exitScope();
-
-    funcSymPtr->isDefined = true;
+    visit(*node.body);
+    scopes.exitScope();
 }
 
 // Statement Nodes
 void AnalyzerVisitor::visit(VariableDecl &node)
 {
+    if (node.isConst && node.init == nullptr)
+        throw std::runtime_error(std::format("Constant '{}' needs a value", node.name.str()));
+
     // no initializer and no type annotation
     if (node.init == nullptr && node.type == Type::Unknown)
         throw std::runtime_error("Missing type annotation in variable declaration");
-    
+
+    node.type = resolve_length(node.type);
+
     // has initializer
     if (node.init != nullptr)
     {
-        node.init->accept(*this);
+        dispatch(*node.init);
 
         // infer type if no annotation
         if (node.type == Type::Unknown)
             node.type = node.init->type;
+        else
+            convert_literal(*node.init, node.type);
     
         // check conflicting types if annotation is present
-        if (node.type != node.init->type)
+        if (!assignable(node.init->type, node.type))
             throw std::runtime_error("Type mismatch when declaring a variable");
+
+        check_view(*node.init, node.type);
+        node.init = fold(node.init);
     }
 
     VarSymbol varSymbol;
     varSymbol.name = node.name;
     varSymbol.type = node.type;
-    varSymbol.isMutable = true;
+    varSymbol.isMutable = !node.isConst;
     varSymbol.llvmValue = nullptr;
 
-    symbols->addVariable(varSymbol);
+    if (node.isConst)
+    {
+        if (is_slice(node.type))
+            throw std::runtime_error(std::format("Constant '{}' can't be a slice", node.name.str()));
+
+        if (!is_literal(*node.init) && !is_table(*node.init) && node.init->kind != NodeKind::String)
+            throw std::runtime_error(std::format("The value of constant '{}' isn't known at compile time", node.name.str()));
+
+        if (node.init->kind != NodeKind::String)
+            varSymbol.value = node.init;
+    }
+    // a local that keeps its initial value is as good as a constant
+    else if (node.init != nullptr && is_literal(*node.init) && !assigned.contains(node.name))
+        varSymbol.value = node.init;
+
+    scopes.addVariable(varSymbol);
 }
 
 void AnalyzerVisitor::visit(Assignment &node)
 {
-    node.lhs->accept(*this);
-    node.rhs->accept(*this);
+    dispatch(*node.lhs);
+    dispatch(*node.rhs);
+    convert_literal(*node.rhs, node.lhs->type);
 
-    if (node.lhs->type != node.rhs->type)
+    if (!assignable(node.rhs->type, node.lhs->type))
         throw std::runtime_error("Type mismatch when assigning a variable");
+
+    // neither a constant nor an element of a constant table
+    Expr *target = node.lhs->kind == NodeKind::Index ? static_cast<Index *>(node.lhs)->base : node.lhs;
+
+    if (target->kind == NodeKind::Variable)
+    {
+        Identifier name = static_cast<Variable *>(target)->name;
+
+        if (!scopes.lookupVariable(name)->isMutable)
+            throw std::runtime_error(std::format("Cannot assign to constant '{}'", name.str()));
+    }
+
+    check_view(*node.rhs, node.lhs->type);
+
+    if (node.lhs->kind == NodeKind::Index)
+        node.lhs = fold(node.lhs);
+    node.rhs = fold(node.rhs);
 }
 
 void AnalyzerVisitor::visit(Block &node)
 {
     for (auto &stmnt : node.statements)
-        stmnt->accept(*this);
+        dispatch(*stmnt);
 }
 
 void AnalyzerVisitor::visit(If &node)
 {
-    node.cond->accept(*this);
+    dispatch(*node.cond);
 
-    if (node.cond->type == Type::String)
+    if (!is_scalar(node.cond->type))
         throw std::runtime_error("If condition must be int or bool");
 
-    symbols->enterScope();
-    node.then_branch->accept(*this);
-    symbols->exitScope();
+    node.cond = fold(node.cond);
+
+    scopes.enterScope();
+    visit(*node.then_branch);
+    scopes.exitScope();
 
     if (node.else_branch != nullptr)
     {
-        symbols->enterScope();
-        node.else_branch->accept(*this);
-        symbols->exitScope();
+        scopes.enterScope();
+        visit(*node.else_branch);
+        scopes.exitScope();
+    }
+
+    // the branch that never runs is checked, but not generated
+    if (is_literal(*node.cond))
+    {
+        if (is_true(*node.cond))
+            node.else_branch = nullptr;
+        else
+            node.then_branch = nodes.make<Block>(std::span<Statement *>());
     }
 }
 
 void AnalyzerVisitor::visit(While &node)
 {
-    node.cond->accept(*this);
+    dispatch(*node.cond);
 
-    if (node.cond->type == Type::String)
+    if (!is_scalar(node.cond->type))
         throw std::runtime_error("If condition must be int or bool");
 
-    symbols->enterScope();
-    node.body->accept(*this);
-    symbols->exitScope();
+    node.cond = fold(node.cond);
+
+    scopes.enterScope();
+    visit(*node.body);
+    scopes.exitScope();
+
+    if (is_literal(*node.cond) && !is_true(*node.cond))
+        node.body = nodes.make<Block>(std::span<Statement *>());
 }
 
 void AnalyzerVisitor::visit(Return &node)
@@ -193,20 +466,29 @@ void AnalyzerVisitor::visit(Return &node)
         throw std::runtime_error("No return value from a non-void function");
 
     // value return from typed function
-    node.value->accept(*this);
+    dispatch(*node.value);
+    convert_literal(*node.value, currentFuncReturnType);
+
+    // the array's storage goes away with the function
+    if (is_array(node.value->type) && is_slice(currentFuncReturnType))
+        throw std::runtime_error("Returning a slice of a local array");
+
     if (currentFuncReturnType != node.value->type)
         throw std::runtime_error("Return type mismatch");
+
+    node.value = fold(node.value);
 }
 
 void AnalyzerVisitor::visit(ExprStatement &node)
 {
-    node.expression->accept(*this);
+    dispatch(*node.expression);
+    node.expression = fold(node.expression);
 }
 
 // Expression Nodes
 void AnalyzerVisitor::visit(Variable &node)
 {
-    const VarSymbol *varSymPtr = symbols->lookupVariable(node.name);
+    const VarSymbol *varSymPtr = scopes.lookupVariable(node.name);
 
     if (varSymPtr == nullptr)
         throw std::runtime_error("Referenced variable is undeclared");
@@ -216,7 +498,20 @@ void AnalyzerVisitor::visit(Variable &node)
 
 void AnalyzerVisitor::visit(CallExpr &node)
 {
-    const FuncSymbol *funcSymPtr = symbols->lookupFunction(node.callee);
+    // the builtin "len(xs)", the number of elements of an array or a slice
+    if (node.callee == builtin::len)
+    {
+        if (node.args.size() == 1)
+            dispatch(*node.args[0]);
+
+        if (node.args.size() != 1 || !is_composite(node.args[0]->type))
+            throw std::runtime_error("'len' takes one array or slice");
+
+        node.type = Type::Int;
+        return;
+    }
+
+    const FuncSymbol *funcSymPtr = functions.lookupFunction(node.callee);
 
     if (funcSymPtr == nullptr)
         throw std::runtime_error("Referenced function is undefined");
@@ -228,25 +523,29 @@ void AnalyzerVisitor::visit(CallExpr &node)
 
     if (node.args.size() < minRequiredArgs)
     {
-        throw std::runtime_error(std::format("Too few arguments in call to '{}'", node.callee));
+        throw std::runtime_error(std::format("Too few arguments in call to '{}'", node.callee.str()));
     }
 
     if (!funcSymPtr->isVarArg && node.args.size() > funcSymPtr->args.size())
     {
-        throw std::runtime_error(std::format("Too many arguments in call to '{}'", node.callee));
+        throw std::runtime_error(std::format("Too many arguments in call to '{}'", node.callee.str()));
     }
 
     // determine type of arguments in callexpr
     for (size_t i = 0; i < node.args.size(); ++i)
     {
-        node.args[i]->accept(*this);
+        dispatch(*node.args[i]);
     }
 
     for (size_t i = 0; i < std::min(node.args.size(), funcSymPtr->args.size()); ++i)
     {
         const auto &param = funcSymPtr->args[i];
-        if (param.type != node.args[i]->type)
-            throw std::runtime_error(std::format("Type mismatch for parameter '{}' in call to '{}'", param.name, node.callee));
+        convert_literal(*node.args[i], param.type);
+
+        if (!assignable(node.args[i]->type, param.type))
+            throw std::runtime_error(std::format("Type mismatch for parameter '{}' in call to '{}'", param.name.str(), node.callee.str()));
+
+        check_view(*node.args[i], param.type);
     }
 
     for (size_t i = node.args.size(); i < funcSymPtr->args.size(); ++i)
@@ -254,7 +553,7 @@ void AnalyzerVisitor::visit(CallExpr &node)
         const auto &arg = funcSymPtr->args[i];
 
         if (!arg.hasInit)
-            throw std::runtime_error(std::format("Missing argument '{}'", arg.name));
+            throw std::runtime_error(std::format("Missing argument '{}'", arg.name.str()));
     }
 
     node.type = funcSymPtr->retType;
@@ -262,117 +561,242 @@ void AnalyzerVisitor::visit(CallExpr &node)
 
 void AnalyzerVisitor::visit(BinaryOp &node)
 {
-    node.lhs->accept(*this);
-    node.rhs->accept(*this);
+    dispatch(*node.lhs);
+    dispatch(*node.rhs);
 
-    Type lt = node.lhs->type;
-    Type rt = node.rhs->type;
+    // "x + 1" with an i64 x adds an i64 1, "x ** 2" with an f64 x keeps its int 2
+    if (!is_integer_power(node.op, node.lhs->type, node.rhs->type))
+        convert_literal(*node.rhs, node.lhs->type);
+    convert_literal(*node.lhs, node.rhs->type);
+
+    node.type = binary_op_type(node.op, node.lhs->type, node.rhs->type);
+}
 
-    if (lt != rt)
+void AnalyzerVisitor::visit(UnaryOp &node)
+{
+    dispatch(*node.rhs);
+
+    // the parser already set the target type
+    if (node.op == unary_convert)
     {
-        throw std::runtime_error(std::format("Type mismatch in binary operation: {} vs {}", type_to_str.at(lt), type_to_str.at(rt)));
+        check_conversion(node.rhs->type, node.type);
+        check_view(*node.rhs, node.type);
     }
+    else
+        node.type = unary_op_type(node.op, node.rhs->type);
+}
+
+void AnalyzerVisitor::visit(Index &node)
+{
+    dispatch(*node.base);
+    dispatch(*node.index);
+
+    Type base = node.base->type;
+
+    if (!is_composite(base))
+        throw std::runtime_error("Only arrays and slices can be indexed");
+
+    if (!is_integer(node.index->type))
+        throw std::runtime_error("Array index must be an integer");
 
-    switch (node.op)
+    // constant indices into arrays are checked here instead of at run time
+    if (node.index->kind == NodeKind::Number && is_array(base))
     {
-    case binop_add:
-    case binop_sub:
-    case binop_mul:
-    case binop_div:
-    case binop_mod:
-        if (lt == Type::String)
-        {
-            throw std::runtime_error("Arithmetic operators require numeric operands");
-        }
+        uint64_t index = static_cast<Number *>(node.index)->value;
+
+        if (index >= array_length(base))
+            throw std::runtime_error(std::format("Index {} is out of bounds for {}", index, type_name(base)));
+    }
+
+    node.type = element_type(base);
+}
+
+// Literal Nodes
+void AnalyzerVisitor::visit(ArrayLiteral &node)
+{
+    for (auto element : node.elements)
+        dispatch(*element);
+
+    // the first element decides the type, literals among the rest take it
+    Type element = node.elements.front()->type;
+
+    if (is_composite(element) || element == Type::Void)
+        throw std::runtime_error("Arrays can only hold numbers, bools and strings");
+
+    for (auto item : node.elements)
+    {
+        convert_literal(*item, element);
+
+        if (item->type != element)
+            throw std::runtime_error(std::format("Array element of type {} in an array of {}", type_name(item->type), type_name(element)));
+    }
+
+    node.type = array_type(element, node.elements.size());
+}
+
+void AnalyzerVisitor::visit(Number &node)
+{
+    // set by the parser from the literal, or converted by its parent
+}
+
+void AnalyzerVisitor::visit(String &node)
+{
+    node.type = Type::String;
+}
+
+void AnalyzerVisitor::visit(Boolean &node)
+{
+    node.type = Type::Bool;
+}
 
-        node.type = lt;
-        break;
 
-    case binop_and:
-    case binop_or:
-        if (lt != Type::Bool)
+namespace
+{
+    FuncSymbol to_symbol(const Prototype &node, bool isDefined)
+    {
+        FuncSymbol funcSymbol;
+        funcSymbol.name = node.name;
+        funcSymbol.retType = node.retType;
+        funcSymbol.isExtern = node.isExtern;
+        funcSymbol.isVarArg = node.isVarArg;
+        funcSymbol.isDefined = isDefined;
+
+        for (const auto &arg : node.args)
         {
-            throw std::runtime_error("Logical operators require boolean operands");
+            ParamSymbol paramSymbol;
+            paramSymbol.name = arg->name;
+            paramSymbol.type = arg->type;
+            paramSymbol.hasInit = arg->init != nullptr;
+
+            funcSymbol.args.push_back(paramSymbol);
         }
 
-        node.type = Type::Bool;
-        break;
+        return funcSymbol;
+    }
+
+    // missing return statement at the end of a function
+    void add_implicit_return(Definition &node, Context &context)
+    {
+        auto &statements = node.body->statements;
+        if (!statements.empty() && statements.back()->kind == NodeKind::Return)
+            return;
 
-    case binop_bit_and:
-    case binop_bit_or:
-    case binop_bit_xor:
-        if (lt == Type::String)
+        if (node.type->retType == Type::Void)
         {
-            throw std::runtime_error("Bitwise operators require numeric operands");
+            auto emptyReturnStmnt = context.make<Return>(nullptr);
+            statements = context.append<Statement>(statements, emptyReturnStmnt);
         }
-
-        node.type = Type::Int;
-        break;
-
-    case binop_eq:
-    case binop_neq:
-    case binop_lt:
-    case binop_lte:
-    case binop_gt:
-    case binop_gte:
-        if (lt != Type::Int && lt != Type::Bool)
+        // missing return statement from a typed function
+        else
         {
-            throw std::runtime_error("Comparison operators require comparable operands");
+            // insert return 0 in the main function only
+            if (node.type->name == builtin::main)
+            {
+                auto returnStmnt = context.make<Return>(context.make<Number>(0));
+                statements = context.append<Statement>(statements, returnStmnt);
+            }
+            else
+                throw std::runtime_error("Missing return statement in a non-void function");
         }
+    }
 
-        node.type = Type::Bool;
-        break;
+    Prototype &prototype_of(Declaration &declaration)
+    {
+        if (declaration.kind == NodeKind::Definition)
+            return *static_cast<Definition &>(declaration).type;
 
-    default:
-        throw std::runtime_error("Unknown binary operator");
+        return static_cast<Prototype &>(declaration);
     }
 }
 
-void AnalyzerVisitor::visit(UnaryOp &node)
+
+void infer_parameter_types(std::span<Declaration *> declarations, Context &context)
 {
-    node.rhs->accept(*this);
-    Type operandType = node.rhs->type;
+    FunctionTable functions;
+    NodeFactory nodes(context);
+    AnalyzerVisitor checker(functions, nodes);
 
-    switch (node.op)
+    for (auto declaration : declarations)
     {
-    case unary_sub:
-        if (operandType == Type::String)
-            throw std::runtime_error("Unary '-' requires an int or bool operand");
+        Prototype &prototype = prototype_of(*declaration);
 
-        node.type = Type::Int;
-        break;
+        for (auto arg : prototype.args)
+        {
+            if (arg->type != Type::Unknown || !arg->init)
+                continue;
 
-    case unary_not:
-        if (operandType == Type::String)
-            throw std::runtime_error("Unary '!' requires an int or bool operand");
+            try
+            {
+                checker.visit(*arg);
+            }
+            catch (const std::exception &e)
+            {
+                throw std::runtime_error(std::format("In function '{}': parameter '{}' needs a type annotation: {}",
+                    prototype.name.str(), arg->name.str(), e.what()));
+            }
+        }
 
-        node.type = Type::Bool;
-        break;
+        functions.addFunction(to_symbol(prototype, declaration->kind == NodeKind::Definition));
+    }
+}
 
-    case unary_bit_not:
-        if (operandType == Type::String)
-            throw std::runtime_error("Unary '~' requires int operand");
+std::vector<std::string> analyze(std::span<Declaration *> declarations, Context &context, unsigned jobs)
+{
+    std::vector<std::string> errors(declarations.size());
 
-        node.type = Type::Int;
-        break;
+    auto fail = [&](size_t index, const std::exception &e) {
+        errors[index] = std::format("In function '{}': {}", prototype_of(*declarations[index]).name.str(), e.what());
+    };
 
-    default:
-        throw std::runtime_error("Unknown unary operator");
+    // phase one, serial: the table and the arena aren't thread-safe
+    FunctionTable functions;
+    NodeFactory nodes(context);
+    AnalyzerVisitor declarationChecker(functions, nodes);
+
+    for (size_t i = 0; i < declarations.size(); ++i)
+    {
+        Declaration &declaration = *declarations[i];
+        Prototype &prototype = prototype_of(declaration);
+
+        try
+        {
+            if (prototype.name == builtin::len)
+                throw std::runtime_error("'len' is a builtin function");
+
+            declarationChecker.visit(prototype);
+
+            if (declaration.kind == NodeKind::Definition)
+                add_implicit_return(static_cast<Definition &>(declaration), context);
+        }
+        catch (const std::exception &e)
+        {
+            fail(i, e);
+        }
+
+        functions.addFunction(to_symbol(prototype, declaration.kind == NodeKind::Definition));
     }
-}
 
-// Literal Nodes
-void AnalyzerVisitor::visit(Number &node)
-{
-    node.type = Type::Int;
-}
+    // phase two, parallel: bodies only read the table and write their own
+    // nodes, new ones are made through `nodes`
+    std::vector<size_t> bodies;
+    for (size_t i = 0; i < declarations.size(); ++i)
+        if (declarations[i]->kind == NodeKind::Definition && errors[i].empty())
+            bodies.push_back(i);
 
-void AnalyzerVisitor::visit(String &node)
-{
-    node.type = Type::String;
-}
+    parallel_for(bodies.size(), jobs, [&](size_t body) {
+        size_t index = bodies[body];
 
-void AnalyzerVisitor::visit(Boolean &node)
-{
-    node.type = Type::Bool;
+        try
+        {
+            AnalyzerVisitor analyzer(functions, nodes);
+            analyzer.visit(*static_cast<Definition *>(declarations[index]));
+        }
+        catch (const std::exception &e)
+        {
+            fail(index, e);
+        }
+    });
+
+    std::erase(errors, std::string());
+    return errors;
 }
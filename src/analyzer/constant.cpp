@@ -0,0 +1,252 @@
+#include <cmath>
+#include <limits>
+
+#include "analyzer/constant.h"
+#include "analyzer/typing.h"
+
+
+namespace
+{
+    // the bits of an integer or bool of the type, as the generator's IR holds them
+    uint64_t wrap(uint64_t bits, Type type)
+    {
+        switch (type)
+        {
+        case Type::Int: return static_cast<uint64_t>(static_cast<int64_t>(static_cast<int32_t>(bits)));
+        case Type::U32: return static_cast<uint32_t>(bits);
+        case Type::Bool: return bits & 1;
+        default: return bits;
+        }
+    }
+
+    Constant integer(Type type, uint64_t bits) { return Constant{type, wrap(bits, type)}; }
+    Constant boolean(bool value) { return Constant{Type::Bool, value}; }
+
+    // f32 arithmetic done in doubles and then rounded is rounded correctly
+    Constant real(Type type, double value)
+    {
+        return Constant{type, 0, type == Type::F32 ? static_cast<double>(static_cast<float>(value)) : value};
+    }
+
+    // the range of integers a float converts to without poison
+    bool converts_exactly(double value, Type to)
+    {
+        switch (to)
+        {
+        case Type::Int: return value >= -0x1p31 && value < 0x1p31;
+        case Type::I64: return value >= -0x1p63 && value < 0x1p63;
+        case Type::U32: return value >= 0 && value < 0x1p32;
+        case Type::U64: return value >= 0 && value < 0x1p64;
+        default: return false;
+        }
+    }
+
+    // x ** n the way the generator unrolls it, squaring x for each bit of n
+    // and multiplying the squares of the bits that are set
+    double multiply_chain(double x, uint64_t n, Type type)
+    {
+        double result = 1, square = x;
+        bool first = true;
+
+        for (; n; n >>= 1)
+        {
+            if (n & 1)
+            {
+                result = first ? square : real(type, result * square).real;
+                first = false;
+            }
+            if (n > 1)
+                square = real(type, square * square).real;
+        }
+
+        return result;
+    }
+
+    std::optional<Constant> fold_float(BinaryOpType op, double a, double b, Type type)
+    {
+        // f32 literals keep the double they were written as
+        a = real(type, a).real;
+        b = real(type, b).real;
+
+        switch (op)
+        {
+        case binop_add: return real(type, a + b);
+        case binop_sub: return real(type, a - b);
+        case binop_mul: return real(type, a * b);
+        case binop_div: return real(type, a / b);
+        case binop_mod: return real(type, std::fmod(a, b));
+        case binop_exp: return real(type, std::pow(a, b));
+        case binop_gt: return boolean(a > b);
+        case binop_gte: return boolean(a >= b);
+        case binop_lt: return boolean(a < b);
+        case binop_lte: return boolean(a <= b);
+        case binop_eq: return boolean(a == b);
+        case binop_neq: return boolean(a != b);
+        default: return std::nullopt;
+        }
+    }
+
+    std::optional<Constant> fold_integer(BinaryOpType op, uint64_t a, uint64_t b, Type type)
+    {
+        bool isSigned = !is_unsigned(type);
+        int64_t sa = static_cast<int64_t>(a), sb = static_cast<int64_t>(b);
+
+        switch (op)
+        {
+        case binop_add: return integer(type, a + b);
+        case binop_sub: return integer(type, a - b);
+        case binop_mul: return integer(type, a * b);
+
+        case binop_div:
+        case binop_mod:
+        {
+            if (b == 0)
+                return std::nullopt;
+
+            if (!isSigned)
+                return integer(type, op == binop_div ? a / b : a % b);
+
+            // the smallest value divided by -1 overflows
+            int64_t min = type == Type::Int ? std::numeric_limits<int32_t>::min() : std::numeric_limits<int64_t>::min();
+            if (sa == min && sb == -1)
+                return std::nullopt;
+
+            return integer(type, static_cast<uint64_t>(op == binop_div ? sa / sb : sa % sb));
+        }
+
+        case binop_exp:
+        {
+            // 1 / x**-n truncates to 0 unless x is 1 or -1
+            if (isSigned && sb < 0)
+                return integer(type, sa == 1 ? 1 : sa == -1 ? ((b & 1) ? -1 : 1) : 0);
+
+            uint64_t result = 1;
+            for (; b; b >>= 1, a *= a)
+                if (b & 1)
+                    result *= a;
+
+            return integer(type, result);
+        }
+
+        case binop_bit_and: return integer(type, a & b);
+        case binop_bit_or: return integer(type, a | b);
+        case binop_bit_xor: return integer(type, a ^ b);
+
+        case binop_gt: return boolean(isSigned ? sa > sb : a > b);
+        case binop_gte: return boolean(isSigned ? sa >= sb : a >= b);
+        case binop_lt: return boolean(isSigned ? sa < sb : a < b);
+        case binop_lte: return boolean(isSigned ? sa <= sb : a <= b);
+        case binop_eq: return boolean(a == b);
+        case binop_neq: return boolean(a != b);
+
+        default: return std::nullopt;
+        }
+    }
+
+    std::optional<Constant> convert(const Constant &value, Type to)
+    {
+        Type from = value.type;
+
+        if (!is_scalar(to))
+            return std::nullopt;
+
+        if (to == Type::Bool)
+            return boolean(is_float(from) ? real(from, value.real).real != 0 : value.bits != 0);
+
+        if (is_float(from))
+        {
+            double number = real(from, value.real).real;
+
+            if (is_float(to))
+                return real(to, number);
+
+            double truncated = std::trunc(number);
+            if (!converts_exactly(truncated, to))
+                return std::nullopt;
+
+            if (is_unsigned(to))
+                return integer(to, static_cast<uint64_t>(truncated));
+
+            return integer(to, static_cast<uint64_t>(static_cast<int64_t>(truncated)));
+        }
+
+        // bools are 0 or 1, never negative
+        bool fromSigned = from != Type::Bool && !is_unsigned(from);
+
+        if (to == Type::F32)
+            return real(to, fromSigned ? static_cast<float>(static_cast<int64_t>(value.bits)) : static_cast<float>(value.bits));
+        if (to == Type::F64)
+            return real(to, fromSigned ? static_cast<double>(static_cast<int64_t>(value.bits)) : static_cast<double>(value.bits));
+
+        // `bits` already holds the value extended the way the cast extends it
+        return integer(to, value.bits);
+    }
+}
+
+
+std::optional<Constant> fold_binary(BinaryOpType op, const Constant &lhs, const Constant &rhs)
+{
+    Type type = lhs.type;
+
+    // "x ** n" with an int n, folded only where the generator would unroll it
+    if (is_integer_power(op, type, rhs.type))
+    {
+        int64_t n = static_cast<int64_t>(rhs.bits);
+        if (n < -MAX_UNROLLED_POWER || n > MAX_UNROLLED_POWER)
+            return std::nullopt;
+
+        double x = real(type, lhs.real).real;
+        double result = multiply_chain(x, n < 0 ? -n : n, type);
+
+        return real(type, n < 0 ? 1 / result : result);
+    }
+
+    if (is_float(type))
+        return fold_float(op, lhs.real, rhs.real, type);
+
+    if (is_integer(type))
+        return fold_integer(op, lhs.bits, rhs.bits, type);
+
+    // arithmetic on bools is done on single bits, it isn't worth mirroring
+    if (type == Type::Bool)
+    {
+        switch (op)
+        {
+        case binop_and: return boolean(lhs.bits && rhs.bits);
+        case binop_or: return boolean(lhs.bits || rhs.bits);
+        case binop_eq: return boolean(lhs.bits == rhs.bits);
+        case binop_neq: return boolean(lhs.bits != rhs.bits);
+        default: return std::nullopt;
+        }
+    }
+
+    return std::nullopt;
+}
+
+std::optional<Constant> fold_unary(UnaryOpType op, const Constant &operand, Type type)
+{
+    if (op == unary_convert)
+        return convert(operand, type);
+
+    if (op == unary_not)
+        return boolean(is_float(operand.type) ? operand.real == 0 : operand.bits == 0);
+
+    if (!is_numeric(operand.type))
+        return std::nullopt;
+
+    switch (op)
+    {
+    case unary_add:
+        return operand;
+    case unary_sub:
+        if (is_float(operand.type))
+            return real(operand.type, -real(operand.type, operand.real).real);
+        return integer(operand.type, 0 - operand.bits);
+    case unary_bit_not:
+        if (is_float(operand.type))
+            return std::nullopt;
+        return integer(operand.type, ~operand.bits);
+    default:
+        return std::nullopt;
+    }
+}
@@ -1,24 +1,24 @@
 #include "analyzer/symbols.h"
 
-void SymbolTable::enterScope()
+void ScopeStack::enterScope()
 {
     varScopes.emplace_back();
 }
 
-void SymbolTable::exitScope()
+void ScopeStack::exitScope()
 {
     if (!varScopes.empty())
         varScopes.pop_back();
 }
 
-void SymbolTable::addVariable(const VarSymbol &var)
+void ScopeStack::addVariable(const VarSymbol &var)
 {
     auto& scope = varScopes.back();
 
     scope.insert({ var.name, var });
 }
 
-VarSymbol* SymbolTable::lookupVariable(const std::string &name)
+VarSymbol* ScopeStack::lookupVariable(Identifier name)
 {
     
     for (auto scope = varScopes.rbegin(); scope != varScopes.rend(); ++scope)
@@ -32,12 +32,12 @@ VarSymbol* SymbolTable::lookupVariable(const std::string &name)
     return nullptr;
 }
 
-void SymbolTable::addFunction(const FuncSymbol &func)
+void FunctionTable::addFunction(const FuncSymbol &func)
 {
     functions.insert({ func.name, func });
 }
 
-FuncSymbol* SymbolTable::lookupFunction(const std::string &name)
+const FuncSymbol* FunctionTable::lookupFunction(Identifier name) const
 {
     auto iter = functions.find(name);
 
@@ -0,0 +1,150 @@
+#include <cstdint>
+#include <format>
+#include <stdexcept>
+
+#include "analyzer/typing.h"
+
+
+Type binary_op_type(BinaryOpType op, Type lt, Type rt)
+{
+    if (is_integer_power(op, lt, rt))
+        return lt;
+
+    if (lt != rt)
+    {
+        throw std::runtime_error(std::format("Type mismatch in binary operation: {} vs {}", type_name(lt), type_name(rt)));
+    }
+
+    switch (op)
+    {
+    case binop_add:
+    case binop_sub:
+    case binop_mul:
+    case binop_div:
+    case binop_mod:
+        if (!is_scalar(lt))
+        {
+            throw std::runtime_error("Arithmetic operators require numeric operands");
+        }
+
+        return lt;
+
+    case binop_exp:
+        if (!is_numeric(lt))
+        {
+            throw std::runtime_error("'**' requires numeric operands");
+        }
+
+        return lt;
+
+    case binop_and:
+    case binop_or:
+        if (lt != Type::Bool)
+        {
+            throw std::runtime_error("Logical operators require boolean operands");
+        }
+
+        return Type::Bool;
+
+    case binop_bit_and:
+    case binop_bit_or:
+    case binop_bit_xor:
+        if (lt != Type::Bool && !is_integer(lt))
+        {
+            throw std::runtime_error("Bitwise operators require integer operands");
+        }
+
+        return lt == Type::Bool ? Type::Int : lt;
+
+    case binop_eq:
+    case binop_neq:
+    case binop_lt:
+    case binop_lte:
+    case binop_gt:
+    case binop_gte:
+        if (lt != Type::Bool && !is_numeric(lt))
+        {
+            throw std::runtime_error("Comparison operators require comparable operands");
+        }
+
+        return Type::Bool;
+
+    default:
+        throw std::runtime_error("Unknown binary operator");
+    }
+}
+
+bool is_integer_power(BinaryOpType op, Type lt, Type rt)
+{
+    return op == binop_exp && is_float(lt) && rt == Type::Int;
+}
+
+Type unary_op_type(UnaryOpType op, Type operandType)
+{
+    switch (op)
+    {
+    case unary_add:
+    case unary_sub:
+        if (!is_scalar(operandType))
+            throw std::runtime_error("Unary '+' and '-' require a numeric or bool operand");
+
+        return is_numeric(operandType) ? operandType : Type::Int;
+
+    case unary_not:
+        if (!is_scalar(operandType) || is_float(operandType))
+            throw std::runtime_error("Unary '!' requires an integer or bool operand");
+
+        return Type::Bool;
+
+    case unary_bit_not:
+        if (operandType != Type::Bool && !is_integer(operandType))
+            throw std::runtime_error("Unary '~' requires an integer operand");
+
+        return operandType == Type::Bool ? Type::Int : operandType;
+
+    default:
+        throw std::runtime_error("Unknown unary operator");
+    }
+}
+
+void check_conversion(Type from, Type to)
+{
+    // "[]T(n)" allocates n elements, "[]T(array)" is a view of the array
+    if (is_slice(to))
+    {
+        if (!is_integer(from) && !assignable(from, to))
+            throw std::runtime_error(std::format("Cannot convert {} to {}", type_name(from), type_name(to)));
+
+        return;
+    }
+
+    if (!is_scalar(from) || !is_scalar(to))
+        throw std::runtime_error(std::format("Cannot convert {} to {}", type_name(from), type_name(to)));
+}
+
+bool assignable(Type from, Type to)
+{
+    if (from == to)
+        return true;
+
+    return is_array(from) && is_slice(to) && element_type(from) == element_type(to);
+}
+
+bool integer_fits(uint64_t value, Type type, bool negated)
+{
+    switch (type)
+    {
+    case Type::Int: return value <= uint64_t(INT32_MAX) + negated;
+    case Type::I64: return value <= uint64_t(INT64_MAX) + negated;
+    case Type::U32: return value <= UINT32_MAX;
+    default: return is_numeric(type);
+    }
+}
+
+bool literal_converts(Type literal, Type target)
+{
+    if (is_integer(literal))
+        return is_numeric(target);
+
+    return is_float(literal) && is_float(target);
+}
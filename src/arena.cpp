@@ -0,0 +1,44 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "arena.h"
+
+
+void Arena::grow(size_t size)
+{
+    size_t blockSize = std::max(size, BLOCK_SIZE);
+
+    blocks.push_back(std::make_unique_for_overwrite<std::byte[]>(blockSize));
+    cursor = blocks.back().get();
+    limit = cursor + blockSize;
+}
+
+void *Arena::allocate(size_t size, size_t align)
+{
+    size_t padding = -reinterpret_cast<uintptr_t>(cursor) & (align - 1);
+
+    if (cursor == nullptr || padding + size > static_cast<size_t>(limit - cursor))
+    {
+        grow(size + align);
+        padding = -reinterpret_cast<uintptr_t>(cursor) & (align - 1);
+    }
+
+    std::byte *ptr = cursor + padding;
+    cursor = ptr + size;
+
+    return ptr;
+}
+
+char *Arena::allocate_chars(size_t count)
+{
+    return static_cast<char *>(allocate(count, alignof(char)));
+}
+
+std::string_view Arena::store(std::string_view str)
+{
+    char *data = allocate_chars(str.size());
+    std::memcpy(data, str.data(), str.size());
+
+    return std::string_view(data, str.size());
+}
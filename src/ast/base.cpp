@@ -3,84 +3,133 @@
 using namespace ast;
 
 Parameter::Parameter(
-    const std::string &name,
+    Identifier name,
     Type type,
-    std::unique_ptr<Expr> init) : name(name),
-                                  type(type),
-                                  init(std::move(init)) {}
+    Expr *init) : ASTNode(NodeKind::Parameter),
+                  name(name),
+                  type(type),
+                  init(init) {}
 
 // - - - - - DECLARATIONS - - - - - //
 Prototype::Prototype(
     Type retType,
-    const std::string &name,
-    std::vector<std::unique_ptr<Parameter>> args,
+    Identifier name,
+    std::span<Parameter *> args,
     bool isExtern,
-    bool isVarArg) : retType(retType),
+    bool isVarArg) : Declaration(NodeKind::Prototype),
+                     retType(retType),
                      name(name),
-                     args(std::move(args)),
+                     args(args),
                      isExtern(isExtern),
                      isVarArg(isVarArg) {}
 
 Definition::Definition(
-    std::unique_ptr<Prototype> type,
-    std::unique_ptr<Block> body) : type(std::move(type)),
-                                   body(std::move(body)) {}
+    Prototype *type,
+    Block *body) : Declaration(NodeKind::Definition),
+                   type(type),
+                   body(body) {}
 
 // - - - - - STATEMENTS - - - - - //
 VariableDecl::VariableDecl(
-    const std::string &name,
+    Identifier name,
     Type type,
-    std::unique_ptr<Expr> init) : name(name),
-                                  type(type),
-                                  init(std::move(init)) {}
+    Expr *init) : Statement(NodeKind::VariableDecl),
+                  name(name),
+                  type(type),
+                  init(init) {}
 
 Assignment::Assignment(
-    std::unique_ptr<Variable> lhs,
-    std::unique_ptr<Expr> rhs) : lhs(std::move(lhs)),
-                                 rhs(std::move(rhs)) {}
-
-// constructor for a list of statements
-Block::Block(std::vector<std::unique_ptr<Statement>> stmts) : statements(std::move(stmts)) {}
-
-// constructor for single-statement bodies
-Block::Block(std::unique_ptr<Statement> stmt)
-{
-    statements.push_back(std::move(stmt));
-}
+    Expr *lhs,
+    Expr *rhs) : Statement(NodeKind::Assignment),
+                 lhs(lhs),
+                 rhs(rhs) {}
 
+Block::Block(std::span<Statement *> stmts) : Statement(NodeKind::Block),
+                                             statements(stmts) {}
 
 If::If(
-    std::unique_ptr<Expr> cond,
-    std::unique_ptr<Block> then_branch,
-    std::unique_ptr<Block> else_branch) : cond(std::move(cond)),
-                                          then_branch(std::move(then_branch)),
-                                          else_branch(std::move(else_branch)) {}
+    Expr *cond,
+    Block *then_branch,
+    Block *else_branch) : Statement(NodeKind::If),
+                          cond(cond),
+                          then_branch(then_branch),
+                          else_branch(else_branch) {}
 
 While::While(
-    std::unique_ptr<Expr> cond,
-    std::unique_ptr<Block> body) : cond(std::move(cond)),
-                                   body(std::move(body)) {}
+    Expr *cond,
+    Block *body) : Statement(NodeKind::While),
+                   cond(cond),
+                   body(body) {}
 
-Return::Return(std::unique_ptr<Expr> value) : value(std::move(value)) {}
+Return::Return(Expr *value) : Statement(NodeKind::Return),
+                              value(value) {}
 
-ExprStatement::ExprStatement(std::unique_ptr<Expr> expression) : expression(std::move(expression)) {}
+ExprStatement::ExprStatement(Expr *expression) : Statement(NodeKind::ExprStatement),
+                                                 expression(expression) {}
 
 // - - - - - EXPRESSIONS - - - - - //
-Variable::Variable(const std::string &name) : name(name) {}
+Variable::Variable(Identifier name) : Expr(NodeKind::Variable),
+                                      name(name) {}
 
 CallExpr::CallExpr(
-    const std::string &callee,
-    std::vector<std::unique_ptr<Expr>> args) : callee(callee),
-                                               args(std::move(args)) {}
+    Identifier callee,
+    std::span<Expr *> args) : Expr(NodeKind::CallExpr),
+                              callee(callee),
+                              args(args) {}
 
 BinaryOp::BinaryOp(
     BinaryOpType op,
-    std::unique_ptr<Expr> lhs,
-    std::unique_ptr<Expr> rhs) : op(op),
-                                 lhs(std::move(lhs)),
-                                 rhs(std::move(rhs)) {}
+    Expr *lhs,
+    Expr *rhs) : Expr(NodeKind::BinaryOp),
+                 op(op),
+                 lhs(lhs),
+                 rhs(rhs) {}
 
 UnaryOp::UnaryOp(
     UnaryOpType op,
-    std::unique_ptr<Expr> rhs) : op(op),
-                                 rhs(std::move(rhs)) {}
+    Expr *rhs) : Expr(NodeKind::UnaryOp),
+                 op(op),
+                 rhs(rhs) {}
+
+Index::Index(
+    Expr *base,
+    Expr *index) : Expr(NodeKind::Index),
+                   base(base),
+                   index(index) {}
+
+// - - - - - LITERALS - - - - - //
+ArrayLiteral::ArrayLiteral(std::span<Expr *> elements) : Expr(NodeKind::ArrayLiteral),
+                                                         elements(elements) {}
+
+
+void ast::collect_assigned(Statement &statement, std::unordered_set<Identifier> &names)
+{
+    switch (statement.kind)
+    {
+        case NodeKind::Assignment:
+        {
+            // storing to an element doesn't change the array or slice itself
+            Expr *target = static_cast<Assignment &>(statement).lhs;
+            if (target->kind == NodeKind::Variable)
+                names.insert(static_cast<Variable *>(target)->name);
+            break;
+        }
+        case NodeKind::Block:
+            for (auto child : static_cast<Block &>(statement).statements)
+                collect_assigned(*child, names);
+            break;
+        case NodeKind::If:
+        {
+            auto &node = static_cast<If &>(statement);
+            collect_assigned(*node.then_branch, names);
+            if (node.else_branch)
+                collect_assigned(*node.else_branch, names);
+            break;
+        }
+        case NodeKind::While:
+            collect_assigned(*static_cast<While &>(statement).body, names);
+            break;
+        default:
+            break;
+    }
+}
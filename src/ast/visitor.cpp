@@ -2,28 +2,19 @@
 
 using namespace ast;
 
-// Literals
-void Number::accept(Visitor &v) { v.visit(*this); }
-void String::accept(Visitor &v) { v.visit(*this); }
-void Boolean::accept(Visitor &v) { v.visit(*this); }
+namespace
+{
+    // Forwards the kind switch to a virtual Visitor
+    class Forwarder : public StaticVisitor<Forwarder>
+    {
+        Visitor &v;
 
-// Statements
-void VariableDecl::accept(Visitor &v) { v.visit(*this); }
-void Assignment::accept(Visitor &v) { v.visit(*this); }
-void Block::accept(Visitor &v) { v.visit(*this); }
-void If::accept(Visitor &v) { v.visit(*this); }
-void While::accept(Visitor &v) { v.visit(*this); }
-void Return::accept(Visitor &v) { v.visit(*this); }
-void ExprStatement::accept(Visitor &v) { v.visit(*this); }
+    public:
+        explicit Forwarder(Visitor &v) : v(v) {}
 
-// Expressions
-void Variable::accept(Visitor &v) { v.visit(*this); }
-void CallExpr::accept(Visitor &v) { v.visit(*this); }
-void BinaryOp::accept(Visitor &v) { v.visit(*this); }
-void UnaryOp::accept(Visitor &v) { v.visit(*this); }
+        template <class T>
+        void visit(T &node) { v.visit(node); }
+    };
+}
 
-// Declarations
-void Prototype::accept(Visitor &v) { v.visit(*this); }
-void Definition::accept(Visitor &v) { v.visit(*this); }
-
-void Parameter::accept(Visitor &v) { v.visit(*this); }
+void ASTNode::accept(Visitor &v) { Forwarder(v).dispatch(*this); }
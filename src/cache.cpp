@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/SHA256.h"
+
+#include "cache.h"
+
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    uint64_t directory_size(const fs::path &directory)
+    {
+        std::error_code error;
+        uint64_t bytes = 0;
+
+        for (auto &file : fs::directory_iterator(directory, error))
+            bytes += file.file_size(error);
+
+        return bytes;
+    }
+
+    // hit and miss counters, shared by every compiler process using the cache
+    struct Counters
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    // Runs `update` on the counters while holding a lock on the stats file
+    template <class F>
+    Counters with_counters(const fs::path &path, int lock, F &&update)
+    {
+        Counters counters;
+
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0)
+            return counters;
+
+        ::flock(fd, lock);
+
+        if (::pread(fd, &counters, sizeof counters, 0) != sizeof counters)
+            counters = {};
+
+        if (update(counters))
+            [[maybe_unused]] auto written = ::pwrite(fd, &counters, sizeof counters, 0);
+
+        ::close(fd);
+        return counters;
+    }
+}
+
+
+std::string cache_key(std::initializer_list<std::string_view> parts)
+{
+    llvm::SHA256 hasher;
+
+    for (auto part : parts)
+    {
+        uint64_t size = part.size();
+        hasher.update(llvm::ArrayRef<uint8_t>(reinterpret_cast<const uint8_t *>(&size), sizeof size));
+        hasher.update(llvm::StringRef(part.data(), part.size()));
+    }
+
+    return llvm::toHex(hasher.final(), true);
+}
+
+std::string compiler_identity()
+{
+    // any rebuild of the compiler changes its size or modification time
+    std::error_code error;
+    fs::path self = fs::read_symlink("/proc/self/exe", error);
+    auto size = fs::file_size(self, error);
+    auto modified = fs::last_write_time(self, error).time_since_epoch().count();
+
+    return std::format("shift {} {} LLVM {}", size, modified, LLVM_VERSION_STRING);
+}
+
+
+fs::path CompileCache::default_directory()
+{
+    if (auto directory = std::getenv("SHIFT_CACHE_DIR"))
+        return directory;
+    if (auto directory = std::getenv("XDG_CACHE_HOME"))
+        return fs::path(directory) / "shift";
+    if (auto home = std::getenv("HOME"))
+        return fs::path(home) / ".cache" / "shift";
+
+    return {};
+}
+
+CompileCache::CompileCache(fs::path root, uint64_t maxBytes) : root(std::move(root)), maxBytes(maxBytes)
+{
+    std::error_code error;
+    fs::create_directories(entries(), error);
+    fs::create_directories(this->root / "tmp", error);
+}
+
+std::optional<std::vector<fs::path>> CompileCache::fetch(const std::string &key)
+{
+    fs::path entry = entries() / key;
+    std::error_code error;
+
+    if (!fs::is_directory(entry, error))
+        return std::nullopt;
+
+    fs::last_write_time(entry, fs::file_time_type::clock::now(), error);
+
+    size_t stored = 0;
+    if (!(std::ifstream(entry / "count") >> stored))
+        return std::nullopt;
+
+    std::vector<fs::path> files;
+    for (auto &file : fs::directory_iterator(entry, error))
+        if (file.path().filename() != "count")
+            files.push_back(file.path());
+
+    // an entry being evicted can lose files while it is listed
+    if (error || files.size() != stored)
+        return std::nullopt;
+
+    // files are named 0, 1, ..., 10, ...
+    std::sort(files.begin(), files.end(), [](const fs::path &a, const fs::path &b) {
+        auto x = a.filename().string(), y = b.filename().string();
+        return x.size() != y.size() ? x.size() < y.size() : x < y;
+    });
+
+    return files;
+}
+
+void CompileCache::store(const std::string &key, const std::vector<fs::path> &files, bool evictAfter)
+{
+    // a failed store only costs the next compile a miss, so errors are dropped
+    std::error_code error;
+    fs::path temporary = root / "tmp" / std::format("{}.{}", key, ::getpid());
+
+    fs::remove_all(temporary, error);
+    fs::create_directories(temporary, error);
+
+    for (size_t i = 0; i < files.size() && !error; ++i)
+        fs::copy_file(files[i], temporary / std::to_string(i), error);
+
+    if (!error && !(std::ofstream(temporary / "count") << files.size()))
+        error = std::make_error_code(std::errc::io_error);
+
+    // renaming onto an existing entry fails, then another process stored it first
+    if (!error)
+        fs::rename(temporary, entries() / key, error);
+
+    if (error)
+        fs::remove_all(temporary, error);
+
+    if (evictAfter)
+        evict();
+}
+
+CompileCache::Stats CompileCache::stats() const
+{
+    Counters counters = with_counters(root / "stats", LOCK_SH, [](Counters &) { return false; });
+
+    Stats stats;
+    stats.hits = counters.hits;
+    stats.misses = counters.misses;
+
+    std::error_code error;
+    for (auto &entry : fs::directory_iterator(entries(), error))
+    {
+        ++stats.entries;
+        stats.bytes += directory_size(entry.path());
+    }
+
+    return stats;
+}
+
+void CompileCache::record(bool hit)
+{
+    with_counters(root / "stats", LOCK_EX, [hit](Counters &counters) {
+        ++(hit ? counters.hits : counters.misses);
+        return true;
+    });
+}
+
+void CompileCache::evict()
+{
+    struct Entry
+    {
+        fs::path path;
+        fs::file_time_type used;
+        uint64_t bytes;
+    };
+
+    std::error_code error;
+    std::vector<Entry> all;
+    uint64_t total = 0;
+
+    for (auto &entry : fs::directory_iterator(entries(), error))
+    {
+        uint64_t bytes = directory_size(entry.path());
+        all.push_back({ entry.path(), entry.last_write_time(error), bytes });
+        total += bytes;
+    }
+
+    // leftovers of compilers that died while storing
+    auto stale = fs::file_time_type::clock::now() - std::chrono::hours(1);
+    for (auto &temporary : fs::directory_iterator(root / "tmp", error))
+        if (temporary.last_write_time(error) < stale)
+            fs::remove_all(temporary.path(), error);
+
+    if (total <= maxBytes)
+        return;
+
+    std::sort(all.begin(), all.end(), [](const Entry &a, const Entry &b) { return a.used < b.used; });
+
+    for (const auto &entry : all)
+    {
+        if (total <= maxBytes)
+            break;
+
+        // moved out of entries first, so fetch never lists it half deleted
+        fs::path victim = root / "tmp" / std::format("{}.{}.evict", entry.path.filename().string(), ::getpid());
+        fs::rename(entry.path, victim, error);
+        if (!error)
+            fs::remove_all(victim, error);
+
+        total -= entry.bytes;
+    }
+}
@@ -1,71 +1,609 @@
 #include <algorithm>
+#include <chrono>
+#include <format>
 #include <fstream>
 #include <filesystem>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <span>
 #include <string>
+#include <unordered_set>
+#include <vector>
 
+#include "llvm/TargetParser/Host.h"
 
+
+#include "source.h"
 #include "lexer.h"
 #include "parser.h"
 #include "analyzer/base.h"
 #include "generator.h"
+#include "linker.h"
+#include "cache.h"
+#include "interface.h"
+#include "workers.h"
 #include "compiler.h"
 
 
-int compile(const std::string &path)
+namespace
 {
-    std::string contents = std::move(read_file(path));
+    // The source, the lexer's strings and the AST nodes all have to outlive
+    // code generation, so they are kept together
+    struct Frontend
+    {
+        std::unique_ptr<SourceBuffer> input;
+        std::unique_ptr<Lexer> lexer;
+        Context context;
+        std::span<Declaration *> ast;
+        std::vector<std::span<const Token>> declarationTokens;
+    };
+
+    // Lexes, parses and analyzes the file. Errors are printed, false means there were some.
+    bool run_frontend(Frontend &frontend, const std::string &path, const CompileOptions &options, bool dump)
+    {
+        if (!frontend.input)
+            frontend.input = SourceBuffer::open(path);
+
+        frontend.lexer = std::make_unique<Lexer>(*frontend.input);
+        const auto &tokens = frontend.lexer->tokenize();
+
+        if (dump)
+        {
+            for (const auto &t : tokens)
+                std::cout << t << std::endl;
+
+            std::cout << "\n";
+        }
+
+        auto parser = Parser(tokens, frontend.context);
+        frontend.ast = parser.parse();
+        frontend.declarationTokens = parser.declaration_tokens();
+
+        if (dump)
+        {
+            auto printer = PrintVisitor();
+            for (const auto &a : frontend.ast)
+                a->accept(printer);
+
+            std::cout << std::endl << std::endl;
+        }
+
+        auto errors = analyze(frontend.ast, frontend.context, options.jobs);
+        if (!errors.empty())
+        {
+            for (const auto &error : errors)
+                std::cerr << error << "\n";
+
+            return false;
+        }
+
+        if (dump)
+        {
+            auto printer = PrintVisitor();
+            for (const auto &a : frontend.ast)
+                a->accept(printer);
+        }
+
+        return true;
+    }
+
+    // The compiler and the target, which every object depends on
+    std::string target_key(const CompileOptions &options)
+    {
+        CodegenOptions codegen = resolve_target(options.codegen);
+
+        return cache_key({
+            compiler_identity(), llvm::sys::getDefaultTargetTriple(), codegen.cpu, codegen.features,
+            std::to_string(static_cast<int>(codegen.optLevel)), std::to_string(static_cast<int>(codegen.lto)),
+            codegen.fastMath ? "fast-math" : "", codegen.boundsCheck ? "bounds-check" : ""
+        });
+    }
+
+    // With LTO the linker runs the optimizer and the backends, at the -O level
+    // and with as many threads as code generation gets
+    LinkOptions link_options(const CompileOptions &options)
+    {
+        LinkOptions link = options.link;
+
+        if (options.codegen.lto != LTOMode::None)
+        {
+            link.lto = true;
+            link.ltoJobs = options.jobs;
 
-    auto lexer = Lexer(contents);
-    auto tokens = lexer.tokenize();
+            switch (options.codegen.optLevel)
+            {
+                case OptLevel::O0: link.ltoOptLevel = 0; break;
+                case OptLevel::O1: link.ltoOptLevel = 1; break;
+                case OptLevel::O3: link.ltoOptLevel = 3; break;
+                default: link.ltoOptLevel = 2; break;
+            }
 
-    for (auto t : tokens)
-        std::cout << t << std::endl;
+            if (!options.cacheDirectory.empty())
+            {
+                link.ltoCacheDirectory = (options.cacheDirectory / "thinlto").string();
+                link.ltoCacheSize = options.cacheSize;
+            }
+        }
 
-    std::cout << "\n";
+        return link;
+    }
+
+    // Everything that goes into the objects: the compiler, the source and the target
+    std::string object_key(std::string_view source, const CompileOptions &options)
+    {
+        return cache_key({
+            "objects", target_key(options), source,
+            options.incremental ? "incremental" : std::to_string(options.partitions)
+        });
+    }
+
+    std::string executable_key(const std::string &objectKey, const LinkOptions &options)
+    {
+        std::string paths;
+        for (const auto &path : options.libraryPaths)
+            paths += path + '\n';
+
+        return cache_key({ "executable", objectKey, paths, options.systemLinker ? "gcc" : "lld" });
+    }
+
+    bool copy_from_cache(const std::vector<std::filesystem::path> &files, const std::vector<std::string> &destinations)
+    {
+        if (files.size() != destinations.size())
+            return false;
+
+        // the entry may be evicted by another compiler while it is copied
+        std::error_code error;
+        for (size_t i = 0; i < files.size() && !error; ++i)
+            std::filesystem::copy_file(files[i], destinations[i], std::filesystem::copy_options::overwrite_existing, error);
+
+        return !error;
+    }
+
+    // One source file of a multi-file build. Its interface comes from the
+    // cache when the file is unchanged, then the file is only lexed and parsed
+    // if its object has to be generated again.
+    struct Unit
+    {
+        std::string path;
+        std::string objectPath;
+        Frontend frontend;
+        const std::vector<Token> *tokens = nullptr;
+        bool parsed = false;
 
-    auto parser = Parser(tokens);
-    auto ast = parser.parse();
+        std::string interface;
+        std::string interfaceKey;
+        std::string objectKey;
+        bool cached = false;
+        std::vector<Prototype *> imports;
 
-    auto printer = PrintVisitor();
-    for (const auto &a : ast)
-        a->accept(printer);
+        std::string error;
+    };
 
-    std::cout << std::endl << std::endl;
+    // Lexing interns identifiers, which isn't thread-safe, so units are lexed
+    // one after another. Everything after it runs one unit per worker.
+    void lex_unit(Unit &unit)
+    {
+        unit.frontend.lexer = std::make_unique<Lexer>(*unit.frontend.input);
+        unit.tokens = &unit.frontend.lexer->tokenize();
+    }
 
-    auto analyzer = AnalyzerVisitor();
-    for (const auto &a : ast)
-        a->accept(analyzer);
+    bool parse_unit(Unit &unit)
+    {
+        try
+        {
+            Parser parser(*unit.tokens, unit.frontend.context);
+            unit.frontend.ast = parser.parse();
+            unit.parsed = true;
+        }
+        catch (const std::exception &e)
+        {
+            unit.error = std::format("{}: {}\n", unit.path, e.what());
+        }
+
+        return unit.parsed;
+    }
 
-    auto printer2 = PrintVisitor();
-    for (const auto &a : ast)
-        a->accept(printer2);
+    // Analyzes the unit together with the prototypes it imports and writes its object
+    bool generate_unit(Unit &unit, const CompileOptions &options)
+    {
+        // the unit's own declarations win over imported ones of the same name
+        std::unordered_set<Identifier> declared;
+        for (auto declaration : unit.frontend.ast)
+            declared.insert(declaration->kind == NodeKind::Definition
+                ? static_cast<Definition *>(declaration)->type->name
+                : static_cast<Prototype *>(declaration)->name);
 
-    auto generator = CodegenVisitor();
-    for (const auto &a : ast)
-        a->accept(generator);
+        std::vector<Declaration *> declarations;
+        for (auto prototype : unit.imports)
+            if (!declared.contains(prototype->name))
+                declarations.push_back(prototype);
+        declarations.insert(declarations.end(), unit.frontend.ast.begin(), unit.frontend.ast.end());
 
-    std::string inputFilename = path.substr(path.find_last_of("/") + 1);
-    std::string outputFilename = inputFilename.substr(0, inputFilename.find_last_of('.')) + ".o";
+        for (const auto &error : analyze(declarations, unit.frontend.context, 1))
+            unit.error += std::format("{}: {}\n", unit.path, error);
+
+        if (!unit.error.empty())
+            return false;
+
+        try
+        {
+            std::string stem = unit.objectPath.substr(0, unit.objectPath.size() - 2);
+            generate_partitions(declarations, stem, 1, options.codegen);
+        }
+        catch (const std::exception &e)
+        {
+            unit.error = std::format("{}: {}\n", unit.path, e.what());
+            return false;
+        }
+
+        return true;
+    }
 
-    std::string objectFilePath = "./" + outputFilename;
-    bool fail = generator.write_to_file(objectFilePath);
-    if (fail) {
+    bool read_file(const std::filesystem::path &path, std::string &text)
+    {
+        std::ifstream file(path, std::ios::binary);
+        text.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+        return !file.bad() && !text.empty();
+    }
+
+    bool write_file(const std::string &path, const std::string &text)
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << text;
+
+        return static_cast<bool>(file);
+    }
+
+    double milliseconds_since(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+
+int compile(const std::string &path, const CompileOptions &options)
+{
+    std::string inputFilename = path == "-" ? "stdin" : path.substr(path.find_last_of("/") + 1);
+    std::string executableName = inputFilename.substr(0, inputFilename.find_last_of('.'));
+    std::string executablePath = "./" + executableName;
+
+    if (options.incremental && options.cacheDirectory.empty())
+    {
+        std::cerr << "Incremental builds keep their objects in the compile cache, it can't be disabled.\n";
+        return 1;
+    }
+
+    Frontend frontend;
+    frontend.input = SourceBuffer::open(path);
+
+    std::optional<CompileCache> cache;
+    std::string objectKey, executableKey;
+
+    if (!options.cacheDirectory.empty())
+    {
+        // the key covers every byte, so streamed input is read in full first
+        while (frontend.input->fill()) {}
+
+        cache.emplace(options.cacheDirectory, options.cacheSize);
+        objectKey = object_key(frontend.input->view(), options);
+        executableKey = executable_key(objectKey, options.link);
+
+        if (auto files = cache->fetch(executableKey); files && copy_from_cache(*files, { executablePath }))
+        {
+            cache->record(true);
+            std::cout << "Successfully generated executable: " << executablePath << " (cached)\n";
+            return 0;
+        }
+
+        // incremental builds look up every function on its own instead
+        if (auto files = options.incremental ? std::nullopt : cache->fetch(objectKey))
+        {
+            std::vector<std::string> objects;
+            for (size_t i = 0; i < files->size(); ++i)
+                objects.push_back(partition_object_path(executablePath, i, files->size()));
+
+            if (copy_from_cache(*files, objects) && link_executable(objects, executablePath, link_options(options)))
+            {
+                cache->store(executableKey, { executablePath });
+                cache->record(true);
+
+                std::cout << "Successfully generated executable: " << executablePath << " (cached objects)\n";
+                return 0;
+            }
+        }
+
+        // reused functions of an incremental build still count as a miss
+        cache->record(false);
+    }
+
+    if (!run_frontend(frontend, path, options, true))
+        return 1;
+
+    auto &ast = frontend.ast;
+
+    std::vector<Partition> partitions;
+    std::vector<std::string> objects;
+    try
+    {
+        if (options.incremental)
+        {
+            auto built = generate_incremental(ast, frontend.declarationTokens, *cache,
+                executablePath + ".objects", target_key(options), options.jobs, options.codegen);
+
+            std::cout << std::format("Reused {} of {} functions\n", built.reused, built.objectPaths.size());
+            objects = std::move(built.objectPaths);
+        }
+        else
+            partitions = generate_partitions(ast, executablePath, options.partitions, options.codegen);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << "\n";
         std::cerr << "Failed to generate object file\n";
         return 1;
     }
 
-    std::string executableName = inputFilename.substr(0, inputFilename.find_last_of('.'));
+    for (const auto &partition : partitions)
+    {
+        partition.generator->get_module().print(llvm::errs(), nullptr);
+        objects.push_back(partition.objectPath);
+    }
 
-    std::string linkCommand = "gcc " + objectFilePath + " -o ./" + executableName;
+    if (cache && !options.incremental)
+        cache->store(objectKey, std::vector<std::filesystem::path>(objects.begin(), objects.end()));
 
-    int linkResult = std::system(linkCommand.c_str());
-    if (linkResult != 0) {
-        std::cerr << "Linking failed with exit code " << linkResult << "\n";
+    if (!link_executable(objects, executablePath, link_options(options)))
         return 1;
+
+    if (cache)
+        cache->store(executableKey, { executablePath });
+
+    std::cout << "Successfully generated executable: " << executablePath << "\n";
+
+    return 0;
+}
+
+int compile(const std::vector<std::string> &paths, const CompileOptions &options)
+{
+    if (paths.size() == 1)
+        return compile(paths.front(), options);
+
+    if (options.incremental)
+    {
+        std::cerr << "--incremental only works on a single file.\n";
+        return 1;
+    }
+
+    std::vector<Unit> units(paths.size());
+    std::unordered_set<std::string> stems;
+
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        std::string stem = paths[i] == "-" ? "stdin" : std::filesystem::path(paths[i]).stem().string();
+        if (!stems.insert(stem).second)
+        {
+            std::cerr << std::format("Two source files are named '{}'.\n", stem);
+            return 1;
+        }
+
+        units[i].path = paths[i];
+        units[i].objectPath = "./" + stem + ".o";
+    }
+
+    std::string executablePath = units.front().objectPath.substr(0, units.front().objectPath.size() - 2);
+
+    std::optional<CompileCache> cache;
+    if (!options.cacheDirectory.empty())
+        cache.emplace(options.cacheDirectory, options.cacheSize);
+
+    // an interface only depends on the source, unchanged files aren't parsed for it
+    for (auto &unit : units)
+    {
+        try
+        {
+            unit.frontend.input = SourceBuffer::open(unit.path);
+            while (unit.frontend.input->fill()) {}
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+
+        unit.interfaceKey = cache_key({ "interface", compiler_identity(), unit.frontend.input->view() });
+        if (cache)
+            if (auto files = cache->fetch(unit.interfaceKey); files && files->size() == 1 && read_file(files->front(), unit.interface))
+                continue;
+
+        lex_unit(unit);
+    }
+
+    parallel_for(units.size(), options.jobs, [&](size_t index) {
+        Unit &unit = units[index];
+
+        if (!unit.interface.empty() || !parse_unit(unit))
+            return;
+
+        try
+        {
+            infer_parameter_types(unit.frontend.ast, unit.frontend.context);
+            unit.interface = write_interface(unit.frontend.ast);
+        }
+        catch (const std::exception &e)
+        {
+            unit.error = std::format("{}: {}\n", unit.path, e.what());
+        }
+    });
+
+    auto report = [&] {
+        bool failed = false;
+        for (const auto &unit : units)
+        {
+            std::cerr << unit.error;
+            failed |= !unit.error.empty();
+        }
+
+        return failed;
+    };
+
+    if (report())
+        return 1;
+
+    // written next to the objects, the cache gets the ones that were just parsed
+    for (const auto &unit : units)
+    {
+        std::string interfacePath = unit.objectPath.substr(0, unit.objectPath.size() - 2) + ".shi";
+        if (write_file(interfacePath, unit.interface) && cache && unit.parsed)
+            cache->store(unit.interfaceKey, { interfacePath }, false);
+    }
+
+    // a unit's object depends on its source and on every interface it imports
+    std::string target = target_key(options);
+    std::string objectKeys;
+
+    for (size_t i = 0; i < units.size(); ++i)
+    {
+        std::string imports;
+        for (size_t j = 0; j < units.size(); ++j)
+            if (j != i)
+                imports += units[j].interface;
+
+        units[i].objectKey = cache_key({ "unit", target, units[i].frontend.input->view(), imports });
+        objectKeys += units[i].objectKey + '\n';
+    }
+
+    std::string executableKey = executable_key(cache_key({ "units", objectKeys }), options.link);
+    if (cache)
+        if (auto files = cache->fetch(executableKey); files && copy_from_cache(*files, { executablePath }))
+        {
+            cache->record(true);
+            std::cout << "Successfully generated executable: " << executablePath << " (cached)\n";
+            return 0;
+        }
+
+    for (size_t i = 0; i < units.size(); ++i)
+    {
+        Unit &unit = units[i];
+
+        if (cache)
+            if (auto files = cache->fetch(unit.objectKey); files && copy_from_cache(*files, { unit.objectPath }))
+            {
+                unit.cached = true;
+                continue;
+            }
+
+        if (!unit.tokens)
+            lex_unit(unit);
+
+        try
+        {
+            for (size_t j = 0; j < units.size(); ++j)
+                if (j != i)
+                    for (auto prototype : read_interface(units[j].interface, unit.frontend.context))
+                        unit.imports.push_back(prototype);
+        }
+        catch (const std::exception &e)
+        {
+            unit.error = std::format("{}: {}\n", unit.path, e.what());
+        }
+    }
+
+    parallel_for(units.size(), options.jobs, [&](size_t index) {
+        Unit &unit = units[index];
+
+        if (unit.cached || !unit.error.empty())
+            return;
+
+        if (!unit.parsed && !parse_unit(unit))
+            return;
+
+        if (generate_unit(unit, options) && cache)
+            cache->store(unit.objectKey, { unit.objectPath }, false);
+    });
+
+    if (report())
+    {
+        std::cerr << "Failed to generate object file\n";
+        return 1;
+    }
+
+    std::vector<std::string> objects;
+    size_t reused = 0;
+    for (const auto &unit : units)
+    {
+        objects.push_back(unit.objectPath);
+        reused += unit.cached;
     }
 
-    std::cout << "Successfully generated executable: ./" << executableName << "\n";
+    if (!link_executable(objects, executablePath, link_options(options)))
+        return 1;
+
+    if (cache)
+    {
+        cache->store(executableKey, { executablePath });
+        cache->record(reused == units.size());
+        std::cout << std::format("Reused {} of {} objects\n", reused, units.size());
+    }
+
+    std::cout << "Successfully generated executable: " << executablePath << "\n";
+
+    return 0;
+}
+
+int run(const std::string &path, const CompileOptions &options)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    Frontend frontend;
+    if (!run_frontend(frontend, path, options, false))
+        return 1;
+
+    double frontendTime = milliseconds_since(start);
+
+    // the JIT compiles every module on its own, there is nothing to link
+    CodegenOptions codegen = options.codegen;
+    codegen.lto = LTOMode::None;
+
+    std::unique_ptr<JIT> jit;
+    try
+    {
+        jit = std::make_unique<JIT>(frontend.ast, codegen);
+        jit->lookup_main();
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    std::cerr << std::format("Ready to run after {:.2f} ms (front end {:.2f} ms)\n", milliseconds_since(start), frontendTime);
+
+    int result = jit->run_main();
+
+    std::cerr << std::format("Compiled {} of {} functions, {} of them again with optimizations\n",
+        jit->compiled_count(), jit->function_count(), jit->optimized_count());
+
+    return result;
+}
+
+int print_cache_stats(const CompileOptions &options)
+{
+    if (options.cacheDirectory.empty())
+    {
+        std::cerr << "The compile cache is disabled.\n";
+        return 1;
+    }
+
+    auto stats = CompileCache(options.cacheDirectory, options.cacheSize).stats();
+    uint64_t compiles = stats.hits + stats.misses;
+
+    std::cout << std::format("cache directory: {}\n", options.cacheDirectory.string());
+    std::cout << std::format("entries:         {}\n", stats.entries);
+    std::cout << std::format("size:            {:.1f} of {:.1f} MiB\n", stats.bytes / 1048576.0, options.cacheSize / 1048576.0);
+    std::cout << std::format("hits:            {} ({:.1f}%)\n", stats.hits, compiles ? 100.0 * stats.hits / compiles : 0.0);
+    std::cout << std::format("misses:          {}\n", stats.misses);
 
     return 0;
-}
\ No newline at end of file
+}
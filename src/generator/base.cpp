@@ -1,7 +1,16 @@
+#include <algorithm>
+#include <format>
+#include <mutex>
+
+#include "llvm/Analysis/ModuleSummaryAnalysis.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
@@ -10,6 +19,7 @@
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/MC/TargetRegistry.h"
+#include "llvm/MC/MCSubtargetInfo.h"
 #include "llvm/Target/TargetOptions.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Support/TargetSelect.h"
@@ -29,16 +39,32 @@
 #include "llvm/Transforms/Scalar/SimplifyCFG.h"
 #include "llvm/Passes/PassBuilder.h"
 #include "llvm/Passes/StandardInstrumentations.h"
+#include "llvm/Transforms/Utils/Mem2Reg.h"
 
 #include "generator.h"
 
 
 llvm::Type* CodegenVisitor::type_to_llvm_type(Type type)
 {
+    if (is_array(type))
+        return llvm::ArrayType::get(type_to_llvm_type(element_type(type)), array_length(type));
+
+    // a pointer to the elements and their count
+    if (is_slice(type))
+        return llvm::StructType::get(*context, { type_to_llvm_type(element_type(type))->getPointerTo(), llvm::Type::getInt32Ty(*context) });
+
     switch (type)
     {
         case Type::Int:
+        case Type::U32:
             return llvm::Type::getInt32Ty(*context); break;
+        case Type::I64:
+        case Type::U64:
+            return llvm::Type::getInt64Ty(*context); break;
+        case Type::F32:
+            return llvm::Type::getFloatTy(*context); break;
+        case Type::F64:
+            return llvm::Type::getDoubleTy(*context); break;
         case Type::Bool:
             return llvm::Type::getInt1Ty(*context); break;
         case Type::String:
@@ -51,28 +77,78 @@ llvm::Type* CodegenVisitor::type_to_llvm_type(Type type)
     }
 }
 
+// Locals that are never reassigned are used as SSA values directly, the rest
+// get a stack slot in the entry block, where mem2reg and SROA can promote it.
+llvm::Value *CodegenVisitor::bind_local(Identifier name, llvm::Value *value)
+{
+    if (!assignedNames.contains(name))
+    {
+        if (!value->hasName())
+            value->setName(name.str());
+        return namedValues[name] = value;
+    }
+
+    llvm::AllocaInst *alloca = create_entry_alloca(value->getType(), name.str());
+    builder->CreateStore(value, alloca);
+
+    return namedValues[name] = alloca;
+}
 
-CodegenVisitor::CodegenVisitor()
+llvm::AllocaInst *CodegenVisitor::create_entry_alloca(llvm::Type *type, const llvm::Twine &name)
 {
-    builder = std::make_unique<llvm::IRBuilder<>>(*context);
+    llvm::Function *function = builder->GetInsertBlock()->getParent();
+    llvm::IRBuilder<> entryBuilder(&function->getEntryBlock(), function->getEntryBlock().begin());
+
+    return entryBuilder.CreateAlloca(type, nullptr, name);
+}
 
-    theSI->registerCallbacks(*thePIC, theMAM.get());
 
-    theFPM->addPass(llvm::InstCombinePass());
-    theFPM->addPass(llvm::ReassociatePass());
-    theFPM->addPass(llvm::GVNPass());
-    theFPM->addPass(llvm::SimplifyCFGPass());
+CodegenOptions resolve_target(const CodegenOptions &options)
+{
+    CodegenOptions resolved = options;
+
+    if (options.cpu == "native")
+    {
+        resolved.cpu = llvm::sys::getHostCPUName().str();
+
+        // sorted, so the same host always gives the same string
+        std::vector<std::string> hostFeatures;
+        llvm::StringMap<bool> featureMap;
+        if (llvm::sys::getHostCPUFeatures(featureMap))
+            for (auto &feature : featureMap)
+                hostFeatures.push_back(std::format("{}{}", feature.second ? '+' : '-', feature.first().str()));
 
-    llvm::PassBuilder PB;
-    PB.registerModuleAnalyses(*theMAM);
-    PB.registerFunctionAnalyses(*theFAM);
-    PB.crossRegisterProxies(*theLAM, *theFAM, *theCGAM, *theMAM);
+        std::sort(hostFeatures.begin(), hostFeatures.end());
 
-    llvm::InitializeAllTargetInfos();
-    llvm::InitializeAllTargets();
-    llvm::InitializeAllTargetMCs();
-    llvm::InitializeAllAsmParsers();
-    llvm::InitializeAllAsmPrinters();
+        resolved.features.clear();
+        for (const auto &feature : hostFeatures)
+            resolved.features += feature + ",";
+
+        // explicit features come last so they win over the host's
+        resolved.features += options.features;
+        if (resolved.features.ends_with(','))
+            resolved.features.pop_back();
+    }
+
+    return resolved;
+}
+
+
+CodegenVisitor::CodegenVisitor(const std::string &moduleName, const CodegenOptions &options) : options(resolve_target(options))
+{
+    context = std::make_unique<llvm::LLVMContext>();
+    module = std::make_unique<llvm::Module>(moduleName, *context);
+    builder = std::make_unique<llvm::IRBuilder<>>(*context);
+
+    // the target registry is global, only the first generator fills it
+    static std::once_flag targetsInitialized;
+    std::call_once(targetsInitialized, [] {
+        llvm::InitializeAllTargetInfos();
+        llvm::InitializeAllTargets();
+        llvm::InitializeAllTargetMCs();
+        llvm::InitializeAllAsmParsers();
+        llvm::InitializeAllAsmPrinters();
+    });
 
     std::string error;
     std::string targetTriple = llvm::sys::getDefaultTargetTriple();
@@ -84,18 +160,114 @@ CodegenVisitor::CodegenVisitor()
         throw std::runtime_error("Target lookup failed");
     }
 
-    std::string cpu = "generic";
-    std::string features = "";
+    const std::string &cpu = this->options.cpu;
+    const std::string &features = this->options.features;
+
+    llvm::CodeGenOptLevel codegenLevel;
+    switch (options.optLevel)
+    {
+        case OptLevel::O0:
+            codegenLevel = llvm::CodeGenOptLevel::None; break;
+        case OptLevel::O1:
+            codegenLevel = llvm::CodeGenOptLevel::Less; break;
+        case OptLevel::O3:
+            codegenLevel = llvm::CodeGenOptLevel::Aggressive; break;
+        default:
+            codegenLevel = llvm::CodeGenOptLevel::Default; break;
+    }
 
     llvm::TargetOptions opt;
-    this->targetMachine = target->createTargetMachine(targetTriple, cpu, features, opt, llvm::Reloc::PIC_);
+    targetMachine.reset(target->createTargetMachine(targetTriple, cpu, features, opt, llvm::Reloc::PIC_, std::nullopt, codegenLevel));
+
+    if (!targetMachine->getMCSubtargetInfo()->isCPUStringValid(cpu))
+        throw std::runtime_error(std::format("Unknown CPU '{}' for target '{}'", cpu, targetTriple));
 
     module->setDataLayout(targetMachine->createDataLayout());
     module->setTargetTriple(targetTriple);
+
+    // every floating point instruction gets the flags
+    if (this->options.fastMath)
+    {
+        llvm::FastMathFlags flags;
+        flags.setFast();
+        builder->setFastMathFlags(flags);
+    }
+
+    // bitcode is compiled by the linker's target machine, which reads these
+    module->setPICLevel(llvm::PICLevel::BigPIC);
+    module->setPIELevel(llvm::PIELevel::Large);
 }
 
 CodegenVisitor::~CodegenVisitor() = default;
 
+void CodegenVisitor::optimize()
+{
+    OptLevel level = options.optLevel;
+
+    // size levels are also function attributes, the backend reads them there
+    for (auto &function : *module)
+    {
+        if (function.isDeclaration())
+            continue;
+
+        if (level == OptLevel::Os || level == OptLevel::Oz)
+            function.addFnAttr(llvm::Attribute::OptimizeForSize);
+        if (level == OptLevel::Oz)
+            function.addFnAttr(llvm::Attribute::MinSize);
+    }
+
+    llvm::LoopAnalysisManager LAM;
+    llvm::FunctionAnalysisManager FAM;
+    llvm::CGSCCAnalysisManager CGAM;
+    llvm::ModuleAnalysisManager MAM;
+
+    llvm::PassInstrumentationCallbacks PIC;
+    llvm::StandardInstrumentations SI(*context, false);
+    SI.registerCallbacks(PIC, &MAM);
+
+    // same vectorizer and unroller defaults as clang
+    llvm::PipelineTuningOptions PTO;
+    PTO.LoopVectorization = level == OptLevel::O2 || level == OptLevel::O3 || level == OptLevel::Os;
+    PTO.SLPVectorization = PTO.LoopVectorization || level == OptLevel::Oz;
+    PTO.LoopUnrolling = level != OptLevel::O0 && level != OptLevel::O1;
+
+    llvm::PassBuilder PB(targetMachine.get(), PTO, std::nullopt, &PIC);
+    PB.registerModuleAnalyses(MAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+    llvm::OptimizationLevel optimization;
+    switch (level)
+    {
+        case OptLevel::O0: optimization = llvm::OptimizationLevel::O0; break;
+        case OptLevel::O1: optimization = llvm::OptimizationLevel::O1; break;
+        case OptLevel::O2: optimization = llvm::OptimizationLevel::O2; break;
+        case OptLevel::O3: optimization = llvm::OptimizationLevel::O3; break;
+        case OptLevel::Os: optimization = llvm::OptimizationLevel::Os; break;
+        case OptLevel::Oz: optimization = llvm::OptimizationLevel::Oz; break;
+    }
+
+    // with LTO the pre-link pipelines leave inlining across modules and the
+    // late loop passes to the linker, which sees every module
+    llvm::ModulePassManager MPM;
+    if (level == OptLevel::O0)
+    {
+        // the remaining stack slots are cheap to promote, the other levels do it with SROA
+        MPM.addPass(llvm::createModuleToFunctionPassAdaptor(llvm::PromotePass()));
+        MPM.addPass(PB.buildO0DefaultPipeline(optimization, options.lto != LTOMode::None));
+    }
+    else if (options.lto == LTOMode::Thin)
+        MPM = PB.buildThinLTOPreLinkDefaultPipeline(optimization);
+    else if (options.lto == LTOMode::Full)
+        MPM = PB.buildLTOPreLinkDefaultPipeline(optimization);
+    else
+        MPM = PB.buildPerModuleDefaultPipeline(optimization);
+
+    MPM.run(*module, MAM);
+}
+
 bool CodegenVisitor::write_to_file(const std::string &path)
 {
     std::error_code EC;
@@ -107,6 +279,22 @@ bool CodegenVisitor::write_to_file(const std::string &path)
         return 1;
     }
 
+    // ThinLTO needs the summary to pick what to import into each module, and
+    // the module hash to find the backend's output in its cache
+    if (options.lto == LTOMode::Thin)
+    {
+        llvm::ProfileSummaryInfo profile(*module);
+        llvm::ModuleSummaryIndex index = llvm::buildModuleSummaryIndex(*module, nullptr, &profile);
+        llvm::WriteBitcodeToFile(*module, dest, false, &index, true);
+        return 0;
+    }
+
+    if (options.lto == LTOMode::Full)
+    {
+        llvm::WriteBitcodeToFile(*module, dest);
+        return 0;
+    }
+
     llvm::legacy::PassManager pass;
     auto filetype = llvm::CodeGenFileType::ObjectFile;
 
@@ -122,29 +310,41 @@ bool CodegenVisitor::write_to_file(const std::string &path)
 }
 
 
-void CodegenVisitor::visit(Variable &node)
+llvm::Value *CodegenVisitor::visit(Variable &node)
 {
-    llvm::AllocaInst *alloca = namedValues[node.name];
+    auto found = namedValues.find(node.name);
 
-    if (!alloca)
+    if (found == namedValues.end())
     {
-        throw std::runtime_error(std::format("Referenced undeclared variable '{}'", node.name));
+        throw std::runtime_error(std::format("Referenced undeclared variable '{}'", node.name.str()));
     }
 
-    lastValue = builder->CreateLoad(alloca->getAllocatedType(), alloca, node.name.c_str());
+    // arrays are used through their storage, they are never loaded as a whole
+    if (is_array(node.type))
+        return found->second;
+
+    if (auto alloca = llvm::dyn_cast<llvm::AllocaInst>(found->second))
+        return builder->CreateLoad(alloca->getAllocatedType(), alloca, node.name.str());
+
+    return found->second;
 }
 
-void CodegenVisitor::visit(Number &node)
+llvm::Value *CodegenVisitor::visit(Number &node)
 {
-    lastValue = llvm::ConstantInt::get(*context, llvm::APInt(32, node.value));
+    llvm::Type *type = type_to_llvm_type(node.type);
+
+    if (is_float(node.type))
+        return llvm::ConstantFP::get(type, node.real);
+
+    return llvm::ConstantInt::get(type, node.value);
 }
 
-void CodegenVisitor::visit(Boolean &node)
+llvm::Value *CodegenVisitor::visit(Boolean &node)
 {
-    lastValue = llvm::ConstantInt::getBool(*context, node.value);
+    return llvm::ConstantInt::getBool(*context, node.value);
 }
 
-void CodegenVisitor::visit(String &node)
+llvm::Value *CodegenVisitor::visit(String &node)
 {
     llvm::Constant *strLiteral = llvm::ConstantDataArray::getString(*context, node.value, true);
 
@@ -164,305 +364,728 @@ void CodegenVisitor::visit(String &node)
 
     llvm::Constant *indices[] = { zero, zero };
     
-    lastValue = llvm::ConstantExpr::getInBoundsGetElementPtr(strType, globalStr, indices);
+    return llvm::ConstantExpr::getInBoundsGetElementPtr(strType, globalStr, indices);
 }
 
-void CodegenVisitor::visit(BinaryOp &node)
+llvm::Value *CodegenVisitor::visit(ArrayLiteral &node)
 {
-    node.lhs->accept(*this);
-    llvm::Value *l = lastValue;
+    llvm::Type *type = type_to_llvm_type(node.type);
+    llvm::AllocaInst *storage = create_entry_alloca(type, "array");
+
+    for (size_t i = 0; i < node.elements.size(); ++i)
+    {
+        llvm::Value *element = dispatch(*node.elements[i]);
+        if (!element)
+            return nullptr;
 
-    node.rhs->accept(*this);
-    llvm::Value *r = lastValue;
+        builder->CreateStore(element, builder->CreateConstInBoundsGEP2_32(type, storage, 0, i));
+    }
+
+    return storage;
+}
+
+llvm::Value *CodegenVisitor::visit(BinaryOp &node)
+{
+    if (node.op == binop_and || node.op == binop_or)
+        return short_circuit(node);
+
+    llvm::Value *l = dispatch(*node.lhs);
+    llvm::Value *r = dispatch(*node.rhs);
 
     if (!l || !r)
+        return nullptr;
+
+    // the analyzer made both operands the same type, except for "x ** n" with
+    // a float x and an int n
+    Type type = node.lhs->type;
+
+    if (node.op == binop_exp)
+        return power(l, r, type, node.rhs->type);
+
+    if (is_float(type))
     {
-        lastValue = nullptr;
-        return;
+        switch (node.op)
+        {
+        case binop_add:
+            return builder->CreateFAdd(l, r, "addtmp");
+        case binop_sub:
+            return builder->CreateFSub(l, r, "subtmp");
+        case binop_mul:
+            return builder->CreateFMul(l, r, "multmp");
+        case binop_div:
+            return builder->CreateFDiv(l, r, "divtmp");
+        case binop_mod:
+            return builder->CreateFRem(l, r, "modtmp");
+        case binop_gt:
+            return builder->CreateFCmpOGT(l, r, "gttmp");
+        case binop_gte:
+            return builder->CreateFCmpOGE(l, r, "getmp");
+        case binop_lt:
+            return builder->CreateFCmpOLT(l, r, "lttmp");
+        case binop_lte:
+            return builder->CreateFCmpOLE(l, r, "letmp");
+        case binop_eq:
+            return builder->CreateFCmpOEQ(l, r, "eqtmp");
+        case binop_neq:
+            return builder->CreateFCmpUNE(l, r, "neqtmp");
+        default:
+            return nullptr;
+        }
     }
 
+    bool isUnsigned = is_unsigned(type);
+
     switch (node.op)
     {
     case binop_add:
-        lastValue = builder->CreateAdd(l, r, "addtmp");
-        return;
+        return builder->CreateAdd(l, r, "addtmp");
     case binop_sub:
-        lastValue = builder->CreateSub(l, r, "subtmp");
-        return;
+        return builder->CreateSub(l, r, "subtmp");
     case binop_mul:
-        lastValue = builder->CreateMul(l, r, "multmp");
-        return;
+        return builder->CreateMul(l, r, "multmp");
     case binop_div:
-        lastValue = builder->CreateSDiv(l, r, "divtmp");
-        return;
+        return isUnsigned ? builder->CreateUDiv(l, r, "divtmp") : builder->CreateSDiv(l, r, "divtmp");
     case binop_mod:
-        lastValue = builder->CreateSRem(l, r, "modtmp");
-        return;
+        return isUnsigned ? builder->CreateURem(l, r, "modtmp") : builder->CreateSRem(l, r, "modtmp");
     case binop_exp:
-        // lastValue = builder->CreateF(l, r, "addtmp");
-        return;
     case binop_and:
-        lastValue = builder->CreateLogicalAnd(l, r, "andtmp");
-        return;
     case binop_or:
-        lastValue = builder->CreateLogicalOr(l, r, "ortmp");
-        return;
+        // lowered above
+        break;
     case binop_bit_xor:
-        lastValue = builder->CreateXor(l, r, "bxortmp");
-        return;
+        return builder->CreateXor(l, r, "bxortmp");
     case binop_bit_and:
-        lastValue = builder->CreateAnd(l, r, "baddtmp");
-        return;
+        return builder->CreateAnd(l, r, "baddtmp");
     case binop_bit_or:
-        lastValue = builder->CreateOr(l, r, "bortmp");
-        return;
+        return builder->CreateOr(l, r, "bortmp");
     case binop_gt:
-        lastValue = builder->CreateICmpSGT(l, r, "gttmp");
-        return;
+        return isUnsigned ? builder->CreateICmpUGT(l, r, "gttmp") : builder->CreateICmpSGT(l, r, "gttmp");
     case binop_gte:
-        lastValue = builder->CreateICmpSGE(l, r, "getmp");
-        return;
+        return isUnsigned ? builder->CreateICmpUGE(l, r, "getmp") : builder->CreateICmpSGE(l, r, "getmp");
     case binop_lt:
-        lastValue = builder->CreateICmpSLT(l, r, "lttmp");
-        return;
+        return isUnsigned ? builder->CreateICmpULT(l, r, "lttmp") : builder->CreateICmpSLT(l, r, "lttmp");
     case binop_lte:
-        lastValue = builder->CreateICmpSLE(l, r, "letmp");
-        return;
+        return isUnsigned ? builder->CreateICmpULE(l, r, "letmp") : builder->CreateICmpSLE(l, r, "letmp");
     case binop_eq:
-        lastValue = builder->CreateICmpEQ(l, r, "eqtmp");
-        return;
+        return builder->CreateICmpEQ(l, r, "eqtmp");
     case binop_neq:
-        lastValue = builder->CreateICmpNE(l, r, "neqtmp");
-        return;
+        return builder->CreateICmpNE(l, r, "neqtmp");
     }
 
-    lastValue = nullptr;
+    return nullptr;
 }
 
-void CodegenVisitor::visit(UnaryOp &node)
+llvm::Value *CodegenVisitor::short_circuit(BinaryOp &node)
 {
-    node.rhs->accept(*this);
-    llvm::Value *r = lastValue;
+    bool isAnd = node.op == binop_and;
 
+    llvm::Value *l = dispatch(*node.lhs);
+    if (!l)
+        return nullptr;
+
+    // a constant lhs decides without a branch, e.g. "false and f()"
+    if (auto constant = llvm::dyn_cast<llvm::ConstantInt>(l))
+        return constant->isOne() == isAnd ? dispatch(*node.rhs) : l;
+
+    llvm::Function *func = builder->GetInsertBlock()->getParent();
+    llvm::BasicBlock *lhsBB = builder->GetInsertBlock();
+    llvm::BasicBlock *rhsBB = llvm::BasicBlock::Create(*context, isAnd ? "and.rhs" : "or.rhs", func);
+    llvm::BasicBlock *mergedBB = llvm::BasicBlock::Create(*context, isAnd ? "and.merged" : "or.merged");
+
+    builder->CreateCondBr(l, isAnd ? rhsBB : mergedBB, isAnd ? mergedBB : rhsBB);
+
+    builder->SetInsertPoint(rhsBB);
+    llvm::Value *r = dispatch(*node.rhs);
     if (!r)
+        return nullptr;
+
+    // the rhs may have branched itself, e.g. for a bounds check
+    rhsBB = builder->GetInsertBlock();
+    builder->CreateBr(mergedBB);
+
+    func->insert(func->end(), mergedBB);
+    builder->SetInsertPoint(mergedBB);
+
+    llvm::PHINode *result = builder->CreatePHI(builder->getInt1Ty(), 2, isAnd ? "andtmp" : "ortmp");
+    result->addIncoming(builder->getInt1(!isAnd), lhsBB);
+    result->addIncoming(r, rhsBB);
+
+    return result;
+}
+
+llvm::Value *CodegenVisitor::power(llvm::Value *base, llvm::Value *exponent, Type type, Type exponentType)
+{
+    if (auto constant = llvm::dyn_cast<llvm::ConstantInt>(exponent))
     {
-        lastValue = nullptr;
-        return;
+        // unsigned exponents are never negative, negative ones of integers
+        // are left to the loop
+        bool negative = !is_unsigned(exponentType) && constant->isNegative();
+        llvm::APInt count = negative ? -constant->getValue() : constant->getValue();
+
+        if (count.ule(MAX_UNROLLED_POWER) && (!negative || is_float(type)))
+        {
+            llvm::Value *chain = multiply_chain(base, count.getZExtValue());
+
+            // "x ** -n" is 1 / x ** n for floats
+            return negative ? builder->CreateFDiv(llvm::ConstantFP::get(base->getType(), 1.0), chain, "powtmp") : chain;
+        }
     }
 
+    if (!is_float(type))
+        return power_loop(base, exponent, type);
+
+    if (is_integer(exponentType))
+        return builder->CreateIntrinsic(llvm::Intrinsic::powi, {base->getType(), exponent->getType()}, {base, exponent}, nullptr, "powtmp");
+
+    return builder->CreateBinaryIntrinsic(llvm::Intrinsic::pow, base, exponent, nullptr, "powtmp");
+}
+
+// squares the base once per bit of count and multiplies together the squares
+// of the bits that are set, e.g. x ** 5 is x * ((x * x) * (x * x))
+llvm::Value *CodegenVisitor::multiply_chain(llvm::Value *base, uint64_t count)
+{
+    bool isFloat = base->getType()->isFloatingPointTy();
+    llvm::Value *result = nullptr;
+    llvm::Value *square = base;
+
+    for (; count; count >>= 1)
+    {
+        if (count & 1)
+            result = !result ? square : isFloat ? builder->CreateFMul(result, square, "powtmp") : builder->CreateMul(result, square, "powtmp");
+
+        if (count > 1)
+            square = isFloat ? builder->CreateFMul(square, square, "sqtmp") : builder->CreateMul(square, square, "sqtmp");
+    }
+
+    if (!result)
+        return isFloat ? llvm::ConstantFP::get(base->getType(), 1.0) : llvm::ConstantInt::get(base->getType(), 1);
+
+    return result;
+}
+
+llvm::Value *CodegenVisitor::power_loop(llvm::Value *base, llvm::Value *exponent, Type type)
+{
+    llvm::Function *function = builder->GetInsertBlock()->getParent();
+    llvm::Type *intType = base->getType();
+    llvm::Value *one = llvm::ConstantInt::get(intType, 1);
+    llvm::Value *zero = llvm::ConstantInt::get(intType, 0);
+    bool isSigned = !is_unsigned(type);
+
+    llvm::BasicBlock *entry = builder->GetInsertBlock();
+    llvm::BasicBlock *loop = llvm::BasicBlock::Create(*context, "pow.loop", function);
+    llvm::BasicBlock *done = llvm::BasicBlock::Create(*context, "pow.done", function);
+
+    // negative exponents skip the loop
+    llvm::Value *any = isSigned ? builder->CreateICmpSGT(exponent, zero, "pow.any") : builder->CreateICmpNE(exponent, zero, "pow.any");
+    builder->CreateCondBr(any, loop, done);
+
+    builder->SetInsertPoint(loop);
+    llvm::PHINode *result = builder->CreatePHI(intType, 2, "pow.result");
+    llvm::PHINode *square = builder->CreatePHI(intType, 2, "pow.square");
+    llvm::PHINode *rest = builder->CreatePHI(intType, 2, "pow.rest");
+
+    llvm::Value *bit = builder->CreateTrunc(rest, builder->getInt1Ty(), "pow.bit");
+    llvm::Value *product = builder->CreateMul(result, square, "pow.product");
+    llvm::Value *nextResult = builder->CreateSelect(bit, product, result, "pow.nextresult");
+    llvm::Value *nextSquare = builder->CreateMul(square, square, "pow.nextsquare");
+    llvm::Value *nextRest = builder->CreateLShr(rest, one, "pow.nextrest");
+
+    result->addIncoming(one, entry);
+    result->addIncoming(nextResult, loop);
+    square->addIncoming(base, entry);
+    square->addIncoming(nextSquare, loop);
+    rest->addIncoming(exponent, entry);
+    rest->addIncoming(nextRest, loop);
+
+    builder->CreateCondBr(builder->CreateICmpNE(nextRest, zero, "pow.more"), loop, done);
+
+    builder->SetInsertPoint(done);
+    llvm::PHINode *power = builder->CreatePHI(intType, 2, "powtmp");
+    power->addIncoming(one, entry);
+    power->addIncoming(nextResult, loop);
+
+    if (!isSigned)
+        return power;
+
+    // 1 / x ** -n truncates to 0 unless x is 1 or -1
+    llvm::Value *minusOne = llvm::ConstantInt::getSigned(intType, -1);
+    llvm::Value *odd = builder->CreateTrunc(exponent, builder->getInt1Ty(), "pow.odd");
+    llvm::Value *sign = builder->CreateSelect(odd, minusOne, one, "pow.sign");
+    llvm::Value *reciprocal = builder->CreateSelect(builder->CreateICmpEQ(base, one, "pow.isone"), one,
+        builder->CreateSelect(builder->CreateICmpEQ(base, minusOne, "pow.isminusone"), sign, zero), "pow.reciprocal");
+
+    return builder->CreateSelect(builder->CreateICmpSLT(exponent, zero, "pow.negative"), reciprocal, power, "powtmp");
+}
+
+llvm::Value *CodegenVisitor::visit(UnaryOp &node)
+{
+    llvm::Value *r = dispatch(*node.rhs);
+
+    if (!r)
+        return nullptr;
+
     switch (node.op)
     {
     case unary_add:
-        lastValue = r;
-        return;
+        return r;
     case unary_sub:
-        lastValue = builder->CreateNeg(r, "negtmp");
-        return;
+        return is_float(node.rhs->type) ? builder->CreateFNeg(r, "negtmp") : builder->CreateNeg(r, "negtmp");
     case unary_not:
-        lastValue = builder->CreateICmpEQ(r, llvm::ConstantInt::get(*context, llvm::APInt()), "nottmp"); // llvm::APInt() defaults to a value of 0
-        return;
+        return builder->CreateICmpEQ(r, llvm::Constant::getNullValue(r->getType()), "nottmp");
     case unary_bit_not:
-        lastValue = builder->CreateNot(r, "bnottmp");
-        return;
+        return builder->CreateNot(r, "bnottmp");
+    case unary_convert:
+        return convert(r, node.rhs->type, node.type);
+    }
+
+    return nullptr;
+}
+
+llvm::Value *CodegenVisitor::convert(llvm::Value *value, Type from, Type to)
+{
+    if (is_slice(to))
+        return is_array(from) ? coerce(value, from, to) : allocate_slice(value, from, to);
+
+    llvm::Type *target = type_to_llvm_type(to);
+
+    if (to == Type::Bool)
+    {
+        if (is_float(from))
+            return builder->CreateFCmpUNE(value, llvm::Constant::getNullValue(value->getType()), "booltmp");
+
+        return builder->CreateICmpNE(value, llvm::Constant::getNullValue(value->getType()), "booltmp");
     }
 
-    lastValue = nullptr;
+    // bools are 0 or 1, never negative
+    bool fromSigned = from != Type::Bool && !is_unsigned(from);
+
+    if (is_float(from) && is_float(to))
+        return builder->CreateFPCast(value, target, "convtmp");
+    if (is_float(from))
+        return is_unsigned(to) ? builder->CreateFPToUI(value, target, "convtmp") : builder->CreateFPToSI(value, target, "convtmp");
+    if (is_float(to))
+        return fromSigned ? builder->CreateSIToFP(value, target, "convtmp") : builder->CreateUIToFP(value, target, "convtmp");
+
+    return builder->CreateIntCast(value, target, fromSigned, "convtmp");
 }
 
-void CodegenVisitor::visit(Parameter &node) { lastValue = nullptr; }
+llvm::Value *CodegenVisitor::visit(Index &node)
+{
+    llvm::Value *address = element_address(node);
+
+    if (!address)
+        return nullptr;
 
-void CodegenVisitor::visit(VariableDecl &node)
+    return builder->CreateLoad(type_to_llvm_type(node.type), address, "elementtmp");
+}
+
+llvm::Value *CodegenVisitor::element_address(Index &node)
 {
+    llvm::Value *base = dispatch(*node.base);
+    llvm::Value *index = dispatch(*node.index);
+
+    if (!base || !index)
+        return nullptr;
+
+    Type type = node.base->type;
+
+    // the analyzer already checked constant indices into arrays
+    if (options.boundsCheck && !(is_array(type) && node.index->kind == NodeKind::Number))
+        check_bounds(index, length_of(base, type));
+
+    llvm::Value *offset = builder->CreateIntCast(index, builder->getInt64Ty(), !is_unsigned(node.index->type), "idxtmp");
+
+    if (is_array(type))
+        return builder->CreateInBoundsGEP(type_to_llvm_type(type), base, { builder->getInt64(0), offset }, "elementptr");
+
+    return builder->CreateInBoundsGEP(type_to_llvm_type(node.type), builder->CreateExtractValue(base, 0, "data"), offset, "elementptr");
+}
+
+// One unsigned compare also catches negative indices. The length of a slice
+// is an SSA value, so in a loop over it the check is loop-invariant apart
+// from the index, and LLVM can hoist or drop it when the loop condition
+// already bounds the index.
+void CodegenVisitor::check_bounds(llvm::Value *index, llvm::Value *length)
+{
+    if (length->getType() != index->getType())
+        length = builder->CreateZExt(length, index->getType());
+
+    llvm::Value *inBounds = builder->CreateICmpULT(index, length, "inbounds");
     llvm::Function *function = builder->GetInsertBlock()->getParent();
 
-    llvm::IRBuilder<> tmpB(&function->getEntryBlock(), function->getEntryBlock().begin());
+    // every failing check of the function traps in the same block
+    if (!boundsFailure)
+    {
+        boundsFailure = llvm::BasicBlock::Create(*context, "outofbounds", function);
+
+        llvm::IRBuilder<> failure(boundsFailure);
+        failure.CreateCall(llvm::Intrinsic::getDeclaration(module.get(), llvm::Intrinsic::trap));
+        failure.CreateUnreachable();
+    }
+
+    llvm::BasicBlock *next = llvm::BasicBlock::Create(*context, "inbounds", function);
+
+    // the weights clang gives __builtin_expect
+    llvm::MDNode *weights = llvm::MDBuilder(*context).createBranchWeights(2000, 1);
+    builder->CreateCondBr(inBounds, next, boundsFailure, weights);
+
+    builder->SetInsertPoint(next);
+}
+
+llvm::Value *CodegenVisitor::length_of(llvm::Value *value, Type type)
+{
+    if (is_array(type))
+        return builder->getInt32(array_length(type));
+
+    return builder->CreateExtractValue(value, 1, "len");
+}
+
+llvm::Value *CodegenVisitor::data_pointer(llvm::Value *value, Type type)
+{
+    if (is_array(type))
+        return builder->CreateConstInBoundsGEP2_32(type_to_llvm_type(type), value, 0, 0, "data");
+
+    return builder->CreateExtractValue(value, 0, "data");
+}
+
+llvm::Value *CodegenVisitor::make_slice(llvm::Value *data, llvm::Value *length, Type type)
+{
+    llvm::Value *slice = llvm::PoisonValue::get(type_to_llvm_type(type));
+    slice = builder->CreateInsertValue(slice, data, 0);
+
+    return builder->CreateInsertValue(slice, length, 1, "slicetmp");
+}
+
+llvm::Value *CodegenVisitor::coerce(llvm::Value *value, Type from, Type to)
+{
+    if (is_array(from) && is_slice(to))
+        return make_slice(data_pointer(value, from), length_of(value, from), to);
+
+    return value;
+}
+
+llvm::Value *CodegenVisitor::allocate_slice(llvm::Value *count, Type countType, Type type)
+{
+    llvm::Value *count64 = builder->CreateIntCast(count, builder->getInt64Ty(), !is_unsigned(countType), "counttmp");
+
+    // the length is an i32, the same check rejects negative counts
+    if (options.boundsCheck)
+        check_bounds(count64, builder->getInt64(uint64_t(INT32_MAX) + 1));
+
+    llvm::Type *element = type_to_llvm_type(element_type(type));
+    uint64_t size = module->getDataLayout().getTypeAllocSize(element);
+
+    llvm::Type *i64 = builder->getInt64Ty();
+    llvm::FunctionCallee calloc = module->getOrInsertFunction(
+        "calloc", llvm::FunctionType::get(builder->getInt8Ty()->getPointerTo(), { i64, i64 }, false));
+
+    llvm::Value *memory = builder->CreateCall(calloc, { count64, builder->getInt64(size) }, "calloctmp");
+    llvm::Value *data = builder->CreatePointerCast(memory, element->getPointerTo());
+
+    return make_slice(data, builder->CreateTrunc(count64, builder->getInt32Ty()), type);
+}
+
+void CodegenVisitor::copy_array(llvm::Value *destination, llvm::Value *source, Type type)
+{
+    llvm::Type *array = type_to_llvm_type(type);
+    llvm::Align align = module->getDataLayout().getPrefTypeAlign(array);
+
+    builder->CreateMemCpy(destination, align, source, align, module->getDataLayout().getTypeAllocSize(array));
+}
+
+llvm::Value *CodegenVisitor::visit(Parameter &node) { return nullptr; }
+
+llvm::Value *CodegenVisitor::visit(VariableDecl &node)
+{
+    if (is_array(node.type))
+        return declare_array(node);
+
+    llvm::Value *value = nullptr;
 
-    llvm::AllocaInst *alloca = tmpB.CreateAlloca(type_to_llvm_type(node.type), nullptr, node.name);
-    namedValues[node.name] = alloca;
-    
     if (node.init != nullptr)
     {
-        node.init->accept(*this);
-        builder->CreateStore(lastValue, alloca);
+        value = dispatch(*node.init);
+
+        if (value)
+            value = coerce(value, node.init->type, node.type);
+    }
+    else
+    {
+        if (node.type == Type::Unknown || node.type == Type::Void)
+            throw std::runtime_error("No default initializer for this type");
+
+        // zero, false or a null string
+        value = llvm::Constant::getNullValue(type_to_llvm_type(node.type));
+    }
+
+    if (!value)
+        return nullptr;
+
+    bind_local(node.name, value);
+
+    return nullptr;
+}
+
+// Arrays live in a stack slot of their own for as long as the function runs,
+// a slot in the entry block is reused by every iteration of a loop.
+llvm::Value *CodegenVisitor::declare_array(VariableDecl &node)
+{
+    llvm::Value *storage = nullptr;
+
+    // a constant table is built once, in read-only memory
+    if (node.isConst)
+    {
+        auto &table = static_cast<ArrayLiteral &>(*node.init);
+        std::vector<llvm::Constant *> elements;
+
+        for (auto element : table.elements)
+            elements.push_back(llvm::cast<llvm::Constant>(dispatch(*element)));
+
+        auto type = llvm::cast<llvm::ArrayType>(type_to_llvm_type(node.type));
+        auto global = new llvm::GlobalVariable(*module, type, true, llvm::GlobalValue::PrivateLinkage,
+                                               llvm::ConstantArray::get(type, elements), node.name.str());
+        global->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+
+        storage = global;
+    }
+    // a literal already has storage of its own
+    else if (node.init != nullptr && node.init->kind == NodeKind::ArrayLiteral)
+    {
+        storage = dispatch(*node.init);
+        if (!storage)
+            return nullptr;
+
+        storage->setName(node.name.str());
     }
     else
     {
-        llvm::Value *defaultVal = nullptr;
+        llvm::Type *type = type_to_llvm_type(node.type);
+        storage = create_entry_alloca(type, node.name.str());
 
-        switch (node.type)
+        if (node.init != nullptr)
         {
-            case Type::Int:
-                defaultVal = llvm::ConstantInt::get(type_to_llvm_type(Type::Int), 0);
-                break;
-            case Type::Bool:
-                defaultVal = llvm::ConstantInt::get(type_to_llvm_type(Type::Bool), 0);
-                break;
-            case Type::String:
-                defaultVal = llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(type_to_llvm_type(Type::String)));
-                break;
-            default:
-                throw std::runtime_error("No default initializer for this type");
-        }
+            llvm::Value *source = dispatch(*node.init);
+            if (!source)
+                return nullptr;
 
-        builder->CreateStore(defaultVal, alloca);
+            copy_array(storage, source, node.type);
+        }
+        else
+        {
+            const llvm::DataLayout &layout = module->getDataLayout();
+            builder->CreateMemSet(storage, builder->getInt8(0), layout.getTypeAllocSize(type), layout.getPrefTypeAlign(type));
+        }
     }
 
-    lastValue = nullptr;
+    namedValues[node.name] = storage;
+
+    return nullptr;
 }
 
-void CodegenVisitor::visit(Assignment &node)
+llvm::Value *CodegenVisitor::visit(Assignment &node)
 {
-    node.rhs->accept(*this);
-    llvm::Value *r = lastValue;
+    llvm::Value *r = dispatch(*node.rhs);
 
     if (!r)
+        return nullptr;
+
+    r = coerce(r, node.rhs->type, node.lhs->type);
+
+    if (node.lhs->kind == NodeKind::Index)
     {
-        lastValue = nullptr;
-        return;
+        llvm::Value *address = element_address(static_cast<Index &>(*node.lhs));
+        if (!address)
+            return nullptr;
+
+        builder->CreateStore(r, address);
+        return r;
     }
 
-    llvm::Value *var = namedValues[node.lhs->name];
+    auto &target = static_cast<Variable &>(*node.lhs);
+    llvm::Value *var = namedValues[target.name];
 
-    builder->CreateStore(r, var);
+    if (is_array(target.type))
+        copy_array(var, r, target.type);
+    else
+        builder->CreateStore(r, var);
 
-    lastValue = r;
+    return r;
 }
 
-void CodegenVisitor::visit(Prototype &node)
+llvm::Value *CodegenVisitor::visit(Prototype &node)
 {
     llvm::Type *type = type_to_llvm_type(node.retType);
 
+    // C functions take a slice as a pointer to its elements
+    bool foreign = node.isExtern && !node.isImported;
+
     std::vector<llvm::Type *> params;
     for (size_t i = 0; i < node.args.size(); ++i)
-        params.push_back(type_to_llvm_type(node.args[i]->type));
+    {
+        Type type = node.args[i]->type;
+
+        if (foreign && is_slice(type))
+            params.push_back(type_to_llvm_type(element_type(type))->getPointerTo());
+        else
+            params.push_back(type_to_llvm_type(type));
+    }
 
     llvm::FunctionType *functionType = llvm::FunctionType::get(type, params, node.isVarArg);
-    llvm::Function *function = llvm::Function::Create(functionType, llvm::Function::ExternalLinkage, node.name, *module);
+    llvm::Function *function = llvm::Function::Create(functionType, llvm::Function::ExternalLinkage, node.name.str(), *module);
+    functions[node.name] = function;
 
     size_t idx = 0;
     for (auto &arg : function->args())
-        arg.setName(node.args[idx++]->name);
+        arg.setName(node.args[idx++]->name.str());
 
-    lastValue = function;
+    return function;
 }
 
-void CodegenVisitor::visit(Definition &node)
+llvm::Function *CodegenVisitor::declare(Prototype &node)
 {
-    llvm::Function *function = module->getFunction(node.type->name);
+    auto found = functions.find(node.name);
 
-    if (function == nullptr)
-    {
-        node.type->accept(*this);
-        function = (llvm::Function *) lastValue;
-    }
+    if (found != functions.end())
+        return found->second;
 
-    if (function == nullptr)
-    {
-        lastValue = nullptr;
-        return;
-    }
+    return llvm::cast<llvm::Function>(visit(node));
+}
+
+llvm::Value *CodegenVisitor::visit(Definition &node)
+{
+    llvm::Function *function = declare(*node.type);
 
     // TODO: handle function redefinition
 
+    // lets the vectorizers and the backend use everything the CPU has
+    function->addFnAttr("target-cpu", options.cpu);
+    if (!options.features.empty())
+        function->addFnAttr("target-features", options.features);
+
+    // the backend's side of -ffast-math, as clang sets it
+    if (options.fastMath)
+        for (auto attribute : { "unsafe-fp-math", "no-infs-fp-math", "no-nans-fp-math", "no-signed-zeros-fp-math", "approx-func-fp-math" })
+            function->addFnAttr(attribute, "true");
+
     llvm::BasicBlock *block = llvm::BasicBlock::Create(*context, "entry", function);
     builder->SetInsertPoint(block);
 
     namedValues.clear();
+    assignedNames.clear();
+    boundsFailure = nullptr;
+    collect_assigned(*node.body, assignedNames);
+
+    size_t idx = 0;
     for (auto &arg : function->args())
-    {
-        llvm::AllocaInst *alloca = builder->CreateAlloca(arg.getType(), nullptr, arg.getName());
-        builder->CreateStore(&arg, alloca);
-        namedValues[arg.getName().str()] = alloca;
-    }
+        bind_local(node.type->args[idx++]->name, &arg);
 
-    node.body->accept(*this);
+    visit(*node.body);
 
-    if (!llvm::verifyFunction(*function))
-    {
-        theFPM->run(*function, *theFAM);
-        lastValue = function;
-        return;
-    }
+    if (llvm::verifyFunction(*function))
+        return nullptr;
 
-    lastValue = nullptr;
+    return function;
 }
 
-void CodegenVisitor::visit(Return &node)
+llvm::Value *CodegenVisitor::visit(Return &node)
 {
     // no return value, e.g.: "return;"
     if (node.value == nullptr)
-    {
-        lastValue = builder->CreateRetVoid();
-        return;
-    }
+        return builder->CreateRetVoid();
 
     // get return value
-    node.value->accept(*this);
-    llvm::Value *retVal = lastValue;
+    llvm::Value *retVal = dispatch(*node.value);
 
     if (!retVal)
-    {
-        lastValue = nullptr;
-        return;
-    }
+        return nullptr;
 
-    lastValue = builder->CreateRet(retVal);
+    return builder->CreateRet(retVal);
 }
 
-void CodegenVisitor::visit(CallExpr &node)
+llvm::Value *CodegenVisitor::visit(CallExpr &node)
 {
-    llvm::Function *callee = module->getFunction(node.callee);
-
-    if (!callee)
+    // the builtin "len(xs)"
+    if (node.callee == builtin::len)
     {
-        lastValue = nullptr;
-        return;
+        llvm::Value *value = dispatch(*node.args[0]);
+        return value ? length_of(value, node.args[0]->type) : nullptr;
     }
 
+    llvm::Function *callee = nullptr;
+
+    if (auto found = functions.find(node.callee); found != functions.end())
+        callee = found->second;
+    else if (calleePrototypes)
+        if (auto prototype = calleePrototypes->find(node.callee); prototype != calleePrototypes->end())
+            callee = declare(*prototype->second);
+
+    if (!callee)
+        return nullptr;
+
     if (!callee->isVarArg())
     {
         if (node.args.size() != callee->arg_size())
-        {
-            lastValue = nullptr;
-            return;
-        }
+            return nullptr;
     }
     else
     {
         if (node.args.size() < callee->arg_size())
-        {
-            lastValue = nullptr;
-            return;
-        }
+            return nullptr;
     }
 
     std::vector<llvm::Value *> argValues;
 
     for (size_t i = 0; i < node.args.size(); ++i)
     {
-        node.args[i]->accept(*this);
-        if (!lastValue)
+        llvm::Value *argValue = dispatch(*node.args[i]);
+        if (!argValue)
+            return nullptr;
+
+        Type type = node.args[i]->type;
+
+        // C's default promotions for variadic arguments, e.g. printf("%f", x) with an f32 x
+        if (i >= callee->arg_size())
         {
-            lastValue = nullptr;
-            return;
+            if (type == Type::F32)
+                argValue = builder->CreateFPExt(argValue, builder->getDoubleTy());
+            else if (type == Type::Bool)
+                argValue = builder->CreateZExt(argValue, builder->getInt32Ty());
+            else if (is_composite(type))
+                argValue = data_pointer(argValue, type);
         }
+        // a C function's slice parameter is a pointer, see visit(Prototype)
+        else if (is_composite(type) && callee->getFunctionType()->getParamType(i)->isPointerTy())
+            argValue = data_pointer(argValue, type);
+        else if (is_array(type))
+            argValue = make_slice(data_pointer(argValue, type), length_of(argValue, type), slice_type(element_type(type)));
 
-        argValues.push_back(lastValue);
+        argValues.push_back(argValue);
     }
 
-    lastValue = builder->CreateCall(callee, argValues, "calltmp");
+    // calls to void functions can't have a name
+    return builder->CreateCall(callee, argValues, callee->getReturnType()->isVoidTy() ? "" : "calltmp");
 }
 
-void CodegenVisitor::visit(If &node)
+llvm::MDNode *CodegenVisitor::branch_weights(BranchHint hint)
 {
-    node.cond->accept(*this);
-    llvm::Value *cond = lastValue;
-
-    if (!cond)
+    // the weights clang gives __builtin_expect, as for bounds checks
+    switch (hint)
     {
-        lastValue = nullptr;
-        return;
+    case BranchHint::Likely:
+        return llvm::MDBuilder(*context).createBranchWeights(2000, 1);
+    case BranchHint::Unlikely:
+        return llvm::MDBuilder(*context).createBranchWeights(1, 2000);
+    default:
+        return nullptr;
     }
+}
+
+llvm::Value *CodegenVisitor::visit(If &node)
+{
+    llvm::Value *cond = dispatch(*node.cond);
+
+    if (!cond)
+        return nullptr;
 
     llvm::Function *func = builder->GetInsertBlock()->getParent();
 
@@ -473,11 +1096,15 @@ void CodegenVisitor::visit(If &node)
     if (node.else_branch)
         elseBB = llvm::BasicBlock::Create(*context, "else", func);
 
-    builder->CreateCondBr(cond, thenBB, elseBB ? elseBB : mergedBB);
+    // numeric conditions are true when non-zero
+    if (node.cond->type != Type::Bool)
+        cond = convert(cond, node.cond->type, Type::Bool);
+
+    builder->CreateCondBr(cond, thenBB, elseBB ? elseBB : mergedBB, branch_weights(node.hint));
 
     // - - - THEN BLOCK - - - //
     builder->SetInsertPoint(thenBB);
-    node.then_branch->accept(*this);
+    visit(*node.then_branch);
 
     auto terminator = builder->GetInsertBlock()->getTerminator();
     if (!terminator || !llvm::isa<llvm::ReturnInst>(terminator))
@@ -489,7 +1116,7 @@ void CodegenVisitor::visit(If &node)
     if (node.else_branch)
     {
         builder->SetInsertPoint(elseBB);
-        node.else_branch->accept(*this);
+        visit(*node.else_branch);
 
         auto terminator = builder->GetInsertBlock()->getTerminator();
         if (!terminator || !llvm::isa<llvm::ReturnInst>(terminator))
@@ -502,10 +1129,10 @@ void CodegenVisitor::visit(If &node)
     func->insert(func->end(), mergedBB);
     builder->SetInsertPoint(mergedBB);
 
-    lastValue = nullptr;
+    return nullptr;
 }
 
-void CodegenVisitor::visit(While &node)
+llvm::Value *CodegenVisitor::visit(While &node)
 {
     llvm::Function *func = builder->GetInsertBlock()->getParent();
     llvm::BasicBlock *condBB = llvm::BasicBlock::Create(*context, "cond", func);
@@ -516,20 +1143,19 @@ void CodegenVisitor::visit(While &node)
 
     // - - - CONDITION - - - //
     builder->SetInsertPoint(condBB);
-    node.cond->accept(*this);
-    llvm::Value *cond = lastValue;
+    llvm::Value *cond = dispatch(*node.cond);
 
     if (!cond)
-    {
-        lastValue = nullptr;
-        return;
-    }
+        return nullptr;
 
-    builder->CreateCondBr(cond, bodyBB, mergedBB);
+    if (node.cond->type != Type::Bool)
+        cond = convert(cond, node.cond->type, Type::Bool);
+
+    builder->CreateCondBr(cond, bodyBB, mergedBB, branch_weights(node.hint));
 
     // - - - BODY - - - //
     builder->SetInsertPoint(bodyBB);
-    node.body->accept(*this);
+    visit(*node.body);
 
     auto terminator = builder->GetInsertBlock()->getTerminator();
     if (!terminator || !llvm::isa<llvm::ReturnInst>(terminator))
@@ -539,25 +1165,39 @@ void CodegenVisitor::visit(While &node)
     func->insert(func->end(), mergedBB);
     builder->SetInsertPoint(mergedBB);
 
-    lastValue = nullptr;
+    return nullptr;
 }
 
-void CodegenVisitor::visit(Block &node)
+llvm::Value *CodegenVisitor::visit(Block &node)
 {
-    if (node.statements.empty())
+    // declarations in the block may shadow outer locals until it ends
+    std::vector<std::pair<Identifier, llvm::Value *>> shadowed;
+
+    for (auto &statement : node.statements)
     {
-        lastValue = nullptr;
-        return;
+        if (statement->kind == NodeKind::VariableDecl)
+        {
+            Identifier name = static_cast<VariableDecl *>(statement)->name;
+            auto found = namedValues.find(name);
+            shadowed.emplace_back(name, found != namedValues.end() ? found->second : nullptr);
+        }
+
+        dispatch(*statement);
     }
 
-    for (auto &statement : node.statements)
+    for (auto it = shadowed.rbegin(); it != shadowed.rend(); ++it)
     {
-        statement->accept(*this);
+        if (it->second)
+            namedValues[it->first] = it->second;
+        else
+            namedValues.erase(it->first);
     }
+
+    return nullptr;
 }
 
-void CodegenVisitor::visit(ExprStatement &node)
+llvm::Value *CodegenVisitor::visit(ExprStatement &node)
 {
-    node.expression->accept(*this);
-    lastValue = nullptr;
+    dispatch(*node.expression);
+    return nullptr;
 }
@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <filesystem>
+#include <format>
+#include <unordered_set>
+
+#include "generator.h"
+#include "workers.h"
+
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    void collect_callees(Expr &expr, std::unordered_set<Identifier> &callees)
+    {
+        switch (expr.kind)
+        {
+            case NodeKind::CallExpr:
+            {
+                auto &call = static_cast<CallExpr &>(expr);
+                callees.insert(call.callee);
+                for (auto arg : call.args)
+                    collect_callees(*arg, callees);
+                break;
+            }
+            case NodeKind::BinaryOp:
+                collect_callees(*static_cast<BinaryOp &>(expr).lhs, callees);
+                collect_callees(*static_cast<BinaryOp &>(expr).rhs, callees);
+                break;
+            case NodeKind::UnaryOp:
+                collect_callees(*static_cast<UnaryOp &>(expr).rhs, callees);
+                break;
+            case NodeKind::Index:
+                collect_callees(*static_cast<Index &>(expr).base, callees);
+                collect_callees(*static_cast<Index &>(expr).index, callees);
+                break;
+            case NodeKind::ArrayLiteral:
+                for (auto element : static_cast<ArrayLiteral &>(expr).elements)
+                    collect_callees(*element, callees);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void collect_callees(Statement &statement, std::unordered_set<Identifier> &callees)
+    {
+        switch (statement.kind)
+        {
+            case NodeKind::VariableDecl:
+                if (auto init = static_cast<VariableDecl &>(statement).init)
+                    collect_callees(*init, callees);
+                break;
+            case NodeKind::Assignment:
+                collect_callees(*static_cast<Assignment &>(statement).lhs, callees);
+                collect_callees(*static_cast<Assignment &>(statement).rhs, callees);
+                break;
+            case NodeKind::Block:
+                for (auto child : static_cast<Block &>(statement).statements)
+                    collect_callees(*child, callees);
+                break;
+            case NodeKind::If:
+            {
+                auto &node = static_cast<If &>(statement);
+                collect_callees(*node.cond, callees);
+                collect_callees(*node.then_branch, callees);
+                if (node.else_branch)
+                    collect_callees(*node.else_branch, callees);
+                break;
+            }
+            case NodeKind::While:
+                collect_callees(*static_cast<While &>(statement).cond, callees);
+                collect_callees(*static_cast<While &>(statement).body, callees);
+                break;
+            case NodeKind::Return:
+                if (auto value = static_cast<Return &>(statement).value)
+                    collect_callees(*value, callees);
+                break;
+            case NodeKind::ExprStatement:
+                collect_callees(*static_cast<ExprStatement &>(statement).expression, callees);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // everything a call to the function is generated from, with types by
+    // name since the numbers of array types vary between runs
+    std::string signature(const Prototype &prototype)
+    {
+        std::string text = std::format("{} {} {} {}", prototype.name.str(),
+            type_name(prototype.retType), prototype.isExtern, prototype.isVarArg);
+
+        for (auto arg : prototype.args)
+            text += std::format(" {}", type_name(arg->type));
+
+        return text;
+    }
+}
+
+
+std::string fingerprint_definition(
+    Definition &definition,
+    std::span<const Token> tokens,
+    const PrototypeTable &prototypes,
+    const std::string &salt)
+{
+    // lexemes are length-prefixed, so "a b" and "ab" differ, but whitespace,
+    // comments and line numbers don't count
+    std::string source;
+    for (const auto &token : tokens)
+        source += std::format("{} {}:{}", static_cast<int>(token.type), token.lexeme.size(), token.lexeme);
+
+    std::unordered_set<Identifier> called;
+    collect_callees(*definition.body, called);
+
+    // sorted, so the key doesn't depend on the set's order
+    std::vector<std::string> signatures;
+    for (auto callee : called)
+        if (auto prototype = prototypes.find(callee); prototype != prototypes.end())
+            signatures.push_back(signature(*prototype->second));
+
+    std::sort(signatures.begin(), signatures.end());
+
+    std::string callees;
+    for (const auto &callee : signatures)
+        callees += callee + '\n';
+
+    return cache_key({ "function", salt, source, callees });
+}
+
+IncrementalObjects generate_incremental(
+    std::span<Declaration *> declarations,
+    std::span<const std::span<const Token>> tokens,
+    CompileCache &cache,
+    const std::string &directory,
+    const std::string &salt,
+    unsigned jobs,
+    const CodegenOptions &options)
+{
+    PrototypeTable prototypes;
+    std::vector<size_t> definitions;
+
+    for (size_t i = 0; i < declarations.size(); ++i)
+    {
+        if (declarations[i]->kind == NodeKind::Definition)
+        {
+            auto definition = static_cast<Definition *>(declarations[i]);
+            prototypes[definition->type->name] = definition->type;
+            definitions.push_back(i);
+        }
+        else
+        {
+            auto prototype = static_cast<Prototype *>(declarations[i]);
+            prototypes[prototype->name] = prototype;
+        }
+    }
+
+    std::error_code error;
+    fs::create_directories(directory, error);
+    if (error)
+        throw std::runtime_error(std::format("Failed to create directory '{}'", directory));
+
+    IncrementalObjects result;
+    std::vector<std::string> keys;
+    std::vector<size_t> changed;
+
+    for (size_t i : definitions)
+    {
+        auto definition = static_cast<Definition *>(declarations[i]);
+        std::string path = (fs::path(directory) / (std::string(definition->type->name.str()) + ".o")).string();
+        std::string key = fingerprint_definition(*definition, tokens[i], prototypes, salt);
+
+        // the entry may be evicted by another compiler while it is copied
+        bool copied = false;
+        if (auto files = cache.fetch(key); files && files->size() == 1)
+            copied = fs::copy_file(files->front(), path, fs::copy_options::overwrite_existing, error) && !error;
+
+        if (copied)
+            ++result.reused;
+        else
+            changed.push_back(result.objectPaths.size());
+
+        result.objectPaths.push_back(std::move(path));
+        keys.push_back(std::move(key));
+    }
+
+    parallel_for(changed.size(), jobs, [&](size_t index) {
+        size_t object = changed[index];
+        auto definition = static_cast<Definition *>(declarations[definitions[object]]);
+        const std::string &path = result.objectPaths[object];
+
+        CodegenVisitor generator(std::string(definition->type->name.str()), options);
+        generator.declare_on_demand(prototypes);
+        generator.visit(*definition);
+        generator.optimize();
+
+        if (generator.write_to_file(path))
+            throw std::runtime_error(std::format("Failed to write object file '{}'", path));
+
+        cache.store(keys[object], { path }, false);
+    });
+
+    cache.evict();
+
+    // objects of functions that were removed or renamed since the last build
+    std::unordered_set<std::string> current(result.objectPaths.begin(), result.objectPaths.end());
+    for (auto &file : fs::directory_iterator(directory, error))
+        if (file.path().extension() == ".o" && !current.contains(file.path().string()))
+            fs::remove(file.path(), error);
+
+    return result;
+}
@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <stdexcept>
+
+#include "llvm/ExecutionEngine/Orc/CompileUtils.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/TargetParser/SubtargetFeature.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+
+#include "generator/jit.h"
+
+
+namespace
+{
+    template <class T>
+    T unwrap(llvm::Expected<T> value, const std::string &what)
+    {
+        if (!value)
+            throw std::runtime_error(std::format("{}: {}", what, llvm::toString(value.takeError())));
+
+        return std::forward<T>(*value);
+    }
+
+    void check(llvm::Error error, const std::string &what)
+    {
+        if (error)
+            throw std::runtime_error(std::format("{}: {}", what, llvm::toString(std::move(error))));
+    }
+
+    // jumped to by the lazy call-through when a function fails to compile
+    void lazy_compile_failed()
+    {
+        std::cerr << "Failed to compile a function on its first call\n";
+        std::exit(1);
+    }
+
+    constexpr const char *TIER_UP_SYMBOL = "__shift_tier_up";
+
+    std::string body_name(Definition &definition, int tier)
+    {
+        return std::format("{}.tier{}", definition.type->name.str(), tier);
+    }
+}
+
+
+// Defines one function's tier 0 body, generated only once something calls it
+class JIT::FunctionUnit : public llvm::orc::MaterializationUnit
+{
+private:
+    JIT &owner;
+    size_t index;
+
+public:
+    FunctionUnit(JIT &owner, size_t index, llvm::orc::SymbolStringPtr symbol)
+        : MaterializationUnit(Interface({{symbol, llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable}}, nullptr)),
+          owner(owner), index(index) {}
+
+    llvm::StringRef getName() const override { return "FunctionUnit"; }
+
+    void materialize(std::unique_ptr<llvm::orc::MaterializationResponsibility> responsibility) override
+    {
+        llvm::orc::ThreadSafeModule module;
+
+        try
+        {
+            module = owner.generate(index, false);
+        }
+        catch (const std::exception &e)
+        {
+            owner.jit->getExecutionSession().reportError(llvm::make_error<llvm::StringError>(e.what(), llvm::inconvertibleErrorCode()));
+            responsibility->failMaterialization();
+            return;
+        }
+
+        ++owner.compiled;
+        owner.jit->getIRCompileLayer().emit(std::move(responsibility), std::move(module));
+    }
+
+private:
+    void discard(const llvm::orc::JITDylib &, const llvm::orc::SymbolStringPtr &) override {}
+};
+
+
+JIT::JIT(std::span<Declaration *> program, const CodegenOptions &options, unsigned hotCalls)
+    : options(options), hotCalls(hotCalls)
+{
+    for (auto declaration : program)
+    {
+        if (declaration->kind == NodeKind::Definition)
+        {
+            auto definition = static_cast<Definition *>(declaration);
+            definitions.push_back(definition);
+            prototypes[definition->type->name] = definition->type;
+        }
+        else
+        {
+            auto prototype = static_cast<Prototype *>(declaration);
+            prototypes[prototype->name] = prototype;
+        }
+    }
+
+    // a throwaway generator resolves -march=native and checks the CPU name
+    CodegenVisitor host("host", options);
+    llvm::TargetMachine &targetMachine = host.get_target_machine();
+
+    llvm::orc::JITTargetMachineBuilder machineBuilder(targetMachine.getTargetTriple());
+    machineBuilder.setCPU(targetMachine.getTargetCPU().str());
+    machineBuilder.getFeatures() = llvm::SubtargetFeatures(targetMachine.getTargetFeatureString());
+
+    machineBuilder.setCodeGenOptLevel(targetMachine.getOptLevel());
+    optimizingMachine = unwrap(machineBuilder.createTargetMachine(), "Failed to create the target machine");
+
+    machineBuilder.setCodeGenOptLevel(llvm::CodeGenOptLevel::None);
+    jit = unwrap(llvm::orc::LLJITBuilder().setJITTargetMachineBuilder(std::move(machineBuilder)).create(), "Failed to create the JIT");
+
+    auto &session = jit->getExecutionSession();
+    auto &mainDylib = jit->getMainJITDylib();
+    const llvm::Triple &triple = targetMachine.getTargetTriple();
+
+    optimizingLayer = std::make_unique<llvm::orc::IRCompileLayer>(
+        session, jit->getObjLinkingLayer(), std::make_unique<llvm::orc::SimpleCompiler>(*optimizingMachine));
+
+    auto hostSymbols = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(jit->getDataLayout().getGlobalPrefix());
+    mainDylib.addGenerator(unwrap(std::move(hostSymbols), "Failed to load host symbols"));
+
+    llvm::orc::SymbolMap callbacks;
+    callbacks[jit->mangleAndIntern(TIER_UP_SYMBOL)] = {
+        llvm::orc::ExecutorAddr::fromPtr(&JIT::tier_up), llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable};
+    check(mainDylib.define(llvm::orc::absoluteSymbols(std::move(callbacks))), "Failed to define the JIT callbacks");
+
+    bodies = &unwrap(jit->createJITDylib("bodies"), "Failed to create the JIT dylib");
+    bodies->addToLinkOrder(mainDylib);
+
+    callThrough = unwrap(
+        llvm::orc::createLocalLazyCallThroughManager(triple, session, llvm::orc::ExecutorAddr::fromPtr(&lazy_compile_failed)),
+        "Failed to create the lazy call-through manager");
+    stubs = llvm::orc::createLocalIndirectStubsManagerBuilder(triple)();
+
+    llvm::orc::SymbolAliasMap aliases;
+    for (size_t i = 0; i < definitions.size(); ++i)
+    {
+        auto body = jit->mangleAndIntern(body_name(*definitions[i], 0));
+        check(bodies->define(std::make_unique<FunctionUnit>(*this, i, body)), "Failed to define a function");
+
+        aliases[jit->mangleAndIntern(definitions[i]->type->name.str())] = {
+            body, llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable};
+    }
+
+    check(mainDylib.define(llvm::orc::lazyReexports(*callThrough, *stubs, *bodies, std::move(aliases))), "Failed to define the function stubs");
+}
+
+llvm::orc::ThreadSafeModule JIT::generate(size_t index, bool optimize)
+{
+    Definition &definition = *definitions[index];
+    std::string name(definition.type->name.str());
+
+    CodegenOptions unitOptions = options;
+    if (!optimize)
+        unitOptions.optLevel = OptLevel::O0;
+
+    CodegenVisitor generator(name, unitOptions);
+    generator.declare_on_demand(prototypes);
+
+    if (!generator.visit(definition))
+        throw std::runtime_error(std::format("Failed to generate function '{}'", name));
+
+    generator.optimize();
+
+    llvm::Module &module = generator.get_module();
+    llvm::Function *body = module.getFunction(name);
+    body->setName(body_name(definition, optimize ? 1 : 0));
+
+    if (!optimize)
+    {
+        // recursive calls go through the stub as well, so they pick up tier 1
+        auto stub = llvm::Function::Create(body->getFunctionType(), llvm::Function::ExternalLinkage, name, module);
+        body->replaceAllUsesWith(stub);
+
+        if (options.optLevel != OptLevel::O0)
+            count_calls(*body, index);
+    }
+
+    return llvm::orc::ThreadSafeModule(generator.take_module(), generator.take_context());
+}
+
+void JIT::count_calls(llvm::Function &body, size_t index)
+{
+    llvm::Module &module = *body.getParent();
+    llvm::LLVMContext &context = module.getContext();
+    llvm::Type *int32 = llvm::Type::getInt32Ty(context);
+    llvm::Type *pointer = llvm::PointerType::getUnqual(context);
+
+    auto counter = new llvm::GlobalVariable(
+        module, int32, false, llvm::GlobalValue::InternalLinkage, llvm::ConstantInt::get(int32, 0), body.getName() + ".calls");
+
+    llvm::IRBuilder<> builder(&*body.getEntryBlock().getFirstInsertionPt());
+    llvm::Value *calls = builder.CreateAdd(builder.CreateLoad(int32, counter), builder.getInt32(1));
+    builder.CreateStore(calls, counter);
+
+    llvm::Value *hot = builder.CreateICmpEQ(calls, builder.getInt32(hotCalls));
+    llvm::MDNode *rarely = llvm::MDBuilder(context).createBranchWeights(1, hotCalls);
+    llvm::Instruction *then = llvm::SplitBlockAndInsertIfThen(hot, &*builder.GetInsertPoint(), false, rarely);
+
+    auto tierUpType = llvm::FunctionType::get(builder.getVoidTy(), {pointer, int32}, false);
+    llvm::FunctionCallee tierUp = module.getOrInsertFunction(TIER_UP_SYMBOL, tierUpType);
+
+    builder.SetInsertPoint(then);
+    llvm::Value *self = llvm::ConstantExpr::getIntToPtr(builder.getInt64(reinterpret_cast<uintptr_t>(this)), pointer);
+    builder.CreateCall(tierUp, {self, builder.getInt32(index)});
+}
+
+void JIT::tier_up(JIT *self, uint32_t index)
+{
+    Definition &definition = *self->definitions[index];
+    std::string name(definition.type->name.str());
+
+    // runs inside the program, so nothing may be thrown from here. On failure
+    // the function simply stays at tier 0.
+    try
+    {
+        check(self->optimizingLayer->add(*self->bodies, self->generate(index, true)), "Failed to add module");
+
+        auto body = unwrap(self->jit->lookup(*self->bodies, body_name(definition, 1)), "Failed to compile");
+        check(self->stubs->updatePointer(*self->jit->mangleAndIntern(name), body), "Failed to update the stub");
+
+        ++self->optimized;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << std::format("Failed to optimize function '{}': {}\n", name, e.what());
+    }
+}
+
+
+void JIT::lookup_main()
+{
+    auto main = std::find_if(definitions.begin(), definitions.end(), [](Definition *definition) {
+        return definition->type->name == builtin::main;
+    });
+
+    if (main == definitions.end())
+        throw std::runtime_error("No 'main' function to run");
+
+    // it is called through a plain function pointer, which has to match
+    auto &prototype = *(*main)->type;
+    if (!prototype.args.empty() || prototype.isVarArg)
+        throw std::runtime_error("'main' can't take parameters when it is run");
+    if (prototype.retType != Type::Int && prototype.retType != Type::Void)
+        throw std::runtime_error(std::format("'main' has to return int or nothing to be run, not {}", type_name(prototype.retType)));
+
+    mainReturnsVoid = prototype.retType == Type::Void;
+
+    // only the stub is needed to call it, but compiling the body here keeps
+    // that out of the program's run time
+    unwrap(jit->lookup(*bodies, body_name(**main, 0)), "Failed to compile 'main'");
+    mainAddress = unwrap(jit->lookup("main"), "Failed to look up 'main'");
+}
+
+int JIT::run_main()
+{
+    if (!mainAddress)
+        lookup_main();
+
+    if (mainReturnsVoid)
+    {
+        mainAddress.toPtr<void (*)()>()();
+        return 0;
+    }
+
+    return mainAddress.toPtr<int (*)()>()();
+}
@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <filesystem>
+#include <format>
+
+#include "generator.h"
+#include "workers.h"
+
+
+namespace
+{
+    std::unique_ptr<CodegenVisitor> generate_slice(
+        std::span<Declaration *> declarations,
+        std::span<Definition *> definitions,
+        const std::string &moduleName,
+        const CodegenOptions &options)
+    {
+        auto generator = std::make_unique<CodegenVisitor>(moduleName, options);
+
+        for (auto declaration : declarations)
+        {
+            if (declaration->kind == NodeKind::Definition)
+                generator->declare(*static_cast<Definition *>(declaration)->type);
+            else
+                generator->declare(*static_cast<Prototype *>(declaration));
+        }
+
+        for (auto definition : definitions)
+            generator->visit(*definition);
+
+        generator->optimize();
+        return generator;
+    }
+
+    std::vector<Definition *> definitions_of(std::span<Declaration *> declarations)
+    {
+        std::vector<Definition *> definitions;
+        for (auto declaration : declarations)
+            if (declaration->kind == NodeKind::Definition)
+                definitions.push_back(static_cast<Definition *>(declaration));
+
+        return definitions;
+    }
+}
+
+
+std::string partition_object_path(const std::string &objectStem, size_t index, size_t count)
+{
+    return count == 1 ? objectStem + ".o" : std::format("{}.{}.o", objectStem, index);
+}
+
+std::vector<Partition> generate_partitions(
+    std::span<Declaration *> declarations,
+    const std::string &objectStem,
+    unsigned jobs,
+    const CodegenOptions &options)
+{
+    std::vector<Definition *> definitions = definitions_of(declarations);
+
+    size_t count = std::clamp<size_t>(jobs, 1, std::max<size_t>(definitions.size(), 1));
+    std::vector<Partition> partitions(count);
+
+    parallel_for(count, count, [&](size_t index) {
+        size_t begin = definitions.size() * index / count;
+        size_t end = definitions.size() * (index + 1) / count;
+
+        Partition &partition = partitions[index];
+        partition.objectPath = partition_object_path(objectStem, index, count);
+
+        std::string moduleName = std::filesystem::path(partition.objectPath).stem().string();
+        partition.generator = generate_slice(declarations, std::span(definitions).subspan(begin, end - begin), moduleName, options);
+
+        if (partition.generator->write_to_file(partition.objectPath))
+            throw std::runtime_error(std::format("Failed to write object file '{}'", partition.objectPath));
+    });
+
+    return partitions;
+}
@@ -0,0 +1,145 @@
+#include <charconv>
+#include <format>
+#include <sstream>
+#include <stdexcept>
+
+#include "interface.h"
+
+
+using namespace ast;
+
+namespace
+{
+    constexpr std::string_view HEADER = "shift-interface 2";
+
+    // parameters without an annotation take the type of their default value,
+    // which has to be inferred before the interface is written
+    Type parameter_type(const Prototype &prototype, const Parameter &parameter)
+    {
+        Type type = parameter.type == Type::Unknown && parameter.init ? parameter.init->type : parameter.type;
+
+        if (type == Type::Unknown)
+            throw std::runtime_error(std::format("Parameter '{}' of '{}' has no type", parameter.name.str(), prototype.name.str()));
+
+        return type;
+    }
+
+    // Builtin types are their number, arrays "[N]T" and slices "[]T". The
+    // numbers of arrays and slices differ from one compiler run to the next.
+    std::string write_type(Type type)
+    {
+        if (is_slice(type))
+            return "[]" + write_type(element_type(type));
+        if (is_array(type))
+            return std::format("[{}]{}", array_length(type), write_type(element_type(type)));
+
+        return std::to_string(static_cast<int>(type));
+    }
+
+    Type parse_type(std::string_view text)
+    {
+        if (text.starts_with("[]"))
+            return slice_type(parse_type(text.substr(2)));
+
+        if (text.starts_with("["))
+        {
+            size_t close = text.find(']');
+            uint32_t length = 0;
+
+            if (close == std::string_view::npos
+                || std::from_chars(text.data() + 1, text.data() + close, length).ec != std::errc())
+                throw std::runtime_error("Malformed interface: invalid type");
+
+            return array_type(parse_type(text.substr(close + 1)), length);
+        }
+
+        int type = -2;
+        auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), type);
+
+        if (ec != std::errc() || end != text.data() + text.size()
+            || type <= static_cast<int>(Type::Unknown) || type > static_cast<int>(Type::F64))
+            throw std::runtime_error("Malformed interface: invalid type");
+
+        return static_cast<Type>(type);
+    }
+
+    Type read_type(std::istringstream &line)
+    {
+        std::string type;
+        line >> type;
+
+        return parse_type(type);
+    }
+}
+
+
+std::string write_interface(std::span<Declaration *> declarations)
+{
+    std::string text = std::string(HEADER) + "\n";
+
+    for (auto declaration : declarations)
+    {
+        if (declaration->kind != NodeKind::Definition)
+            continue;
+
+        const Prototype &prototype = *static_cast<Definition *>(declaration)->type;
+
+        text += std::format("fn {} {} {} {}", prototype.name.str(),
+            write_type(prototype.retType), prototype.isVarArg ? 1 : 0, prototype.args.size());
+
+        for (auto arg : prototype.args)
+            text += std::format(" {} {}", arg->name.str(), write_type(parameter_type(prototype, *arg)));
+
+        text += "\n";
+    }
+
+    return text;
+}
+
+std::vector<Prototype *> read_interface(std::string_view text, Context &context)
+{
+    std::istringstream input{std::string(text)};
+    std::string line;
+
+    if (!std::getline(input, line) || line != HEADER)
+        throw std::runtime_error("Malformed interface: unknown format");
+
+    std::vector<Prototype *> prototypes;
+    std::vector<Parameter *> parameters;
+
+    while (std::getline(input, line))
+    {
+        std::istringstream fields(line);
+        std::string keyword, name;
+        int varArg = 0;
+        size_t count = 0;
+
+        fields >> keyword >> name;
+        Type retType = read_type(fields);
+        fields >> varArg >> count;
+
+        if (!fields || keyword != "fn")
+            throw std::runtime_error(std::format("Malformed interface: '{}'", line));
+
+        parameters.clear();
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::string parameter;
+            fields >> parameter;
+            Type type = read_type(fields);
+
+            if (!fields)
+                throw std::runtime_error(std::format("Malformed interface: '{}'", line));
+
+            parameters.push_back(context.make<Parameter>(Interner::global().intern(parameter), type));
+        }
+
+        auto prototype = context.make<Prototype>(
+            retType, Interner::global().intern(name), context.list<Parameter>(std::span<Parameter *const>(parameters)), true, varArg != 0);
+        prototype->isImported = true;
+
+        prototypes.push_back(prototype);
+    }
+
+    return prototypes;
+}
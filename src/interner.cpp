@@ -0,0 +1,37 @@
+#include "interner.h"
+
+
+std::string_view Identifier::str() const
+{
+    return Interner::global().name(*this);
+}
+
+
+Interner::Interner()
+{
+    // in the order of the ids in `builtin`
+    for (auto name : { "", "len", "main" })
+        intern(name);
+}
+
+Interner &Interner::global()
+{
+    static Interner interner;
+    return interner;
+}
+
+Identifier Interner::intern(std::string_view name)
+{
+    auto found = ids.find(name);
+    if (found != ids.end())
+        return Identifier{found->second};
+
+    // the key has to outlive the source buffer the name came from
+    std::string_view stored = storage.store(name);
+    uint32_t id = static_cast<uint32_t>(names.size());
+
+    ids.emplace(stored, id);
+    names.push_back(stored);
+
+    return Identifier{id};
+}
@@ -3,29 +3,8 @@
 #include <iostream>
 
 #include "lexer.h"
-
-// valid identifiers start with a-zA-Z_
-bool is_valid_identifier_start(char character)
-{
-    return ('a' <= character && character <= 'z') ||
-           ('A' <= character && character <= 'Z') ||
-           character == '_';
-}
-
-// valid identifiers contain a-zA-Z0-9_
-bool is_valid_identifier_body(char character)
-{
-    return ('a' <= character && character <= 'z') ||
-           ('A' <= character && character <= 'Z') ||
-           ('0' <= character && character <= '9') ||
-           character == '_';
-}
-
-// valid numbers contain 0-9
-bool is_valid_number(char character)
-{
-    return ('0' <= character && character <= '9');
-}
+#include "lexer/keywords.h"
+#include "lexer/simd.h"
 
 bool has_even_number_of_quotations(const std::string &str)
 {
@@ -44,9 +23,10 @@ bool has_even_number_of_brackets(const std::string &str)
 
 bool Lexer::valid_index() const { return current >= 0 && current < source.size(); }
 
-const char Lexer::peek() const { return source[current]; }
+// the source isn't null-terminated, reading past its end yields '\0'
+const char Lexer::peek() const { return valid_index() ? source[current] : '\0'; }
 const char Lexer::prev() const { return source[current - 1]; }
-const char Lexer::next() const { return source[current + 1]; }
+const char Lexer::next() const { return current + 1 < source.size() ? source[current + 1] : '\0'; }
 const char Lexer::advance()
 {
     if (valid_index())
@@ -59,6 +39,14 @@ const char Lexer::advance()
     return prev();
 }
 
+void Lexer::advance_to(const char *position)
+{
+    size_t target = position - source.data();
+
+    column += target - current;
+    current = target;
+}
+
 bool Lexer::check(char expected) const { return valid_index() && peek() == expected; }
 bool Lexer::match(char expected)
 {
@@ -77,7 +65,7 @@ void Lexer::add_token(TokenType type)
     tokens.push_back(token);
 }
 
-void Lexer::add_token(TokenType type, const std::string &lexeme)
+void Lexer::add_token(TokenType type, std::string_view lexeme)
 {
     Token token(type, Position(line, column), lexeme);
     tokens.push_back(token);
@@ -94,7 +82,7 @@ void Lexer::skip_empty()
         // whitespaces, tabs
         case ' ':
         case '\t':
-            advance();
+            advance_to(simd::skip_spaces(source.data() + current, source.data() + source.size()));
             break;
 
         // CRLF, LF
@@ -108,8 +96,7 @@ void Lexer::skip_empty()
         // single-line comments
         case '/':
             if (next() == '/')
-                while (!check('\n'))
-                    advance();
+                advance_to(simd::find_newline(source.data() + current, source.data() + source.size()));
             else
                 return;
             break;
@@ -146,6 +133,12 @@ void Lexer::scan_token()
     case '}':
         add_token(tok_close_brace);
         break;
+    case '[':
+        add_token(tok_open_bracket);
+        break;
+    case ']':
+        add_token(tok_close_bracket);
+        break;
     case ':':
         add_token(tok_colon);
         break;
@@ -196,40 +189,52 @@ void Lexer::scan_token()
         break;
 
     default:
-        if (std::isdigit(c)) scan_number();
-        else if (std::isalpha(c) || c == '_') scan_identifier();
+        if (is_valid_number(c)) scan_number();
+        else if (is_valid_identifier_start(c)) scan_identifier();
         else
         {
-            add_token(tok_invalid, std::string(1, c));
+            add_token(tok_invalid);
         }
     }
 }
 
 void Lexer::scan_identifier()
 {
-    while (std::isalnum(peek()) || peek() == '_') advance();
+    advance_to(simd::skip_identifier(source.data() + current, source.data() + source.size()));
 
-    std::string lexeme = source.substr(start, current - start);
+    std::string_view lexeme = source.substr(start, current - start);
+    TokenType type = lookup_keyword(lexeme);
 
-    if (keyword_to_token.contains(lexeme))
-    {
-        TokenType type = keyword_to_token.at(lexeme);
-        add_token(type);
-    }
-    else
-        add_token(tok_identifier);
+    add_token(type);
+
+    if (type == tok_identifier)
+        tokens.back().identifier = Interner::global().intern(lexeme);
 }
 
 void Lexer::scan_string()
 {
-    while (valid_index() && peek() != '"')
+    bool has_escapes = false;
+
+    while (true)
     {
+        advance_to(simd::find_string_special(source.data() + current, source.data() + source.size()));
+
+        if (!valid_index() || peek() == '"')
+            break;
+
         if (peek() == '\n')
         {
             column = 0;
             line++;
         }
 
+        // the escaped character can't terminate the literal
+        if (peek() == '\\' && current + 1 < source.size())
+        {
+            has_escapes = true;
+            advance();
+        }
+
         advance();
     }
 
@@ -240,11 +245,18 @@ void Lexer::scan_string()
 
     advance();
 
-    std::string raw = "";
-    if (current > start)
-        raw = source.substr(start + 1, current - start - 2);
+    std::string_view raw = source.substr(start + 1, current - start - 2);
+
+    if (!has_escapes)
+    {
+        add_token(tok_string, raw);
+        return;
+    }
+
+    // decoded value is never longer than the raw one
+    char *value = strings.allocate_chars(raw.size());
+    size_t length = 0;
 
-    std::string value;
     for (size_t i = 0; i < raw.size(); ++i)
     {
         if (raw[i] == '\\' && i + 1 < raw.size())
@@ -252,44 +264,93 @@ void Lexer::scan_string()
             ++i;
             switch (raw[i])
             {
-                case 'n':  value.push_back('\n'); break;
-                case 't':  value.push_back('\t'); break;
-                case '\\': value.push_back('\\'); break;
-                case '"':  value.push_back('"');  break;
+                case 'n':  value[length++] = '\n'; break;
+                case 't':  value[length++] = '\t'; break;
+                case '\\': value[length++] = '\\'; break;
+                case '"':  value[length++] = '"';  break;
                 default:
-                    value.push_back(raw[i]);
+                    value[length++] = raw[i];
                     break;
             }
         }
         else
         {
-            value.push_back(raw[i]);
+            value[length++] = raw[i];
         }
     }
 
-    add_token(tok_string, value);
+    add_token(tok_string, std::string_view(value, length));
 }
 
 void Lexer::scan_number()
 {
-    while (valid_index() && std::isdigit(peek()))
+    while (is_valid_number(peek()))
         advance();
 
     // decimal separator
-    if (peek() == '.' && std::isdigit(next()))
+    if (peek() == '.' && is_valid_number(next()))
     {
         advance();
-        while (std::isdigit(peek())) advance();
+        while (is_valid_number(peek())) advance();
+    }
+
+    // exponent, "1e9" or "2.5e-3"
+    if (peek() == 'e' || peek() == 'E')
+    {
+        size_t digits = current + 1;
+        if (digits < source.size() && (source[digits] == '+' || source[digits] == '-'))
+            ++digits;
+
+        if (digits < source.size() && is_valid_number(source[digits]))
+        {
+            advance_to(source.data() + digits);
+            while (is_valid_number(peek())) advance();
+        }
     }
 
     add_token(tok_number);
 }
 
 
-std::vector<Token> Lexer::tokenize()
+// Until the input is complete, a token that runs up to the end of the bytes
+// read so far might continue in the next chunk, so it's dropped and rescanned
+// once more of the input is available.
+void Lexer::scan_available(bool complete)
 {
     while (valid_index())
+    {
+        size_t token_count = tokens.size();
+        size_t saved_current = current;
+        size_t saved_line = line;
+        size_t saved_column = column;
+
         scan_token();
 
+        if (!complete && current >= source.size())
+        {
+            tokens.resize(token_count);
+            current = saved_current;
+            line = saved_line;
+            column = saved_column;
+            return;
+        }
+    }
+}
+
+const std::vector<Token> &Lexer::tokenize()
+{
+    // rough estimate of one token per 4 bytes of source, avoids most regrowth
+    tokens.reserve(source.size() / 4);
+
+    scan_available(input == nullptr || input->complete());
+
+    // streamed input is lexed chunk by chunk as it arrives
+    while (input != nullptr && !input->complete())
+    {
+        input->fill();
+        source = input->view();
+        scan_available(input->complete());
+    }
+
     return tokens;
 }
@@ -0,0 +1,273 @@
+#include "lexer/charclass.h"
+#include "lexer/simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SHIFT_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+
+namespace
+{
+    struct Kernels
+    {
+        const char *(*skip_spaces)(const char *, const char *);
+        const char *(*skip_identifier)(const char *, const char *);
+        const char *(*find_newline)(const char *, const char *);
+        const char *(*find_string_special)(const char *, const char *);
+    };
+
+    // - - - - - SCALAR - - - - - //
+    const char *scalar_skip_spaces(const char *p, const char *end)
+    {
+        while (p < end && has_char_class(*p, cc_space)) ++p;
+        return p;
+    }
+
+    const char *scalar_skip_identifier(const char *p, const char *end)
+    {
+        while (p < end && has_char_class(*p, cc_identifier_body)) ++p;
+        return p;
+    }
+
+    const char *scalar_find_newline(const char *p, const char *end)
+    {
+        while (p < end && *p != '\n') ++p;
+        return p;
+    }
+
+    const char *scalar_find_string_special(const char *p, const char *end)
+    {
+        while (p < end && *p != '"' && *p != '\\' && *p != '\n') ++p;
+        return p;
+    }
+
+    constexpr Kernels scalar_kernels = {
+        scalar_skip_spaces,
+        scalar_skip_identifier,
+        scalar_find_newline,
+        scalar_find_string_special};
+    // - - - - - - - - - - - - - //
+
+#ifdef SHIFT_SIMD_X86
+    // - - - - - SSE2 - - - - - //
+    // unsigned lo <= v <= hi, SSE2 only has signed compares so both sides are biased by 0x80
+    inline __m128i sse2_in_range(__m128i v, char lo, char hi)
+    {
+        __m128i offset = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+        __m128i biased = _mm_xor_si128(offset, _mm_set1_epi8(static_cast<char>(0x80)));
+        return _mm_cmplt_epi8(biased, _mm_set1_epi8(static_cast<char>((hi - lo + 1) ^ 0x80)));
+    }
+
+    inline __m128i sse2_identifier_mask(__m128i v)
+    {
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i letters = sse2_in_range(lower, 'a', 'z');
+        __m128i digits = sse2_in_range(v, '0', '9');
+        __m128i underscore = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+        return _mm_or_si128(_mm_or_si128(letters, digits), underscore);
+    }
+
+    const char *sse2_skip_spaces(const char *p, const char *end)
+    {
+        for (; end - p >= 16; p += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            __m128i spaces = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+            unsigned mask = ~_mm_movemask_epi8(spaces) & 0xFFFF;
+            if (mask)
+                return p + __builtin_ctz(mask);
+        }
+
+        return scalar_skip_spaces(p, end);
+    }
+
+    const char *sse2_skip_identifier(const char *p, const char *end)
+    {
+        for (; end - p >= 16; p += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            unsigned mask = ~_mm_movemask_epi8(sse2_identifier_mask(v)) & 0xFFFF;
+            if (mask)
+                return p + __builtin_ctz(mask);
+        }
+
+        return scalar_skip_identifier(p, end);
+    }
+
+    const char *sse2_find_newline(const char *p, const char *end)
+    {
+        for (; end - p >= 16; p += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+            if (mask)
+                return p + __builtin_ctz(mask);
+        }
+
+        return scalar_find_newline(p, end);
+    }
+
+    const char *sse2_find_string_special(const char *p, const char *end)
+    {
+        for (; end - p >= 16; p += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            __m128i special = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))),
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+            unsigned mask = _mm_movemask_epi8(special);
+            if (mask)
+                return p + __builtin_ctz(mask);
+        }
+
+        return scalar_find_string_special(p, end);
+    }
+
+    constexpr Kernels sse2_kernels = {
+        sse2_skip_spaces,
+        sse2_skip_identifier,
+        sse2_find_newline,
+        sse2_find_string_special};
+    // - - - - - - - - - - - - - //
+
+    // - - - - - AVX2 - - - - - //
+    __attribute__((target("avx2"))) inline __m256i avx2_in_range(__m256i v, char lo, char hi)
+    {
+        __m256i offset = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+        __m256i biased = _mm256_xor_si256(offset, _mm256_set1_epi8(static_cast<char>(0x80)));
+        return _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>((hi - lo + 1) ^ 0x80)), biased);
+    }
+
+    __attribute__((target("avx2"))) const char *avx2_skip_spaces(const char *p, const char *end)
+    {
+        for (; end - p >= 32; p += 32)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+            __m256i spaces = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')));
+            unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(spaces));
+            if (mask)
+                return p + __builtin_ctz(mask);
+        }
+
+        return sse2_skip_spaces(p, end);
+    }
+
+    __attribute__((target("avx2"))) const char *avx2_skip_identifier(const char *p, const char *end)
+    {
+        for (; end - p >= 32; p += 32)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+            __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+            __m256i identifier = _mm256_or_si256(
+                _mm256_or_si256(avx2_in_range(lower, 'a', 'z'), avx2_in_range(v, '0', '9')),
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+            unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(identifier));
+            if (mask)
+                return p + __builtin_ctz(mask);
+        }
+
+        return sse2_skip_identifier(p, end);
+    }
+
+    __attribute__((target("avx2"))) const char *avx2_find_newline(const char *p, const char *end)
+    {
+        for (; end - p >= 32; p += 32)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+            unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+            if (mask)
+                return p + __builtin_ctz(mask);
+        }
+
+        return sse2_find_newline(p, end);
+    }
+
+    __attribute__((target("avx2"))) const char *avx2_find_string_special(const char *p, const char *end)
+    {
+        for (; end - p >= 32; p += 32)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+            __m256i special = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))),
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+            unsigned mask = _mm256_movemask_epi8(special);
+            if (mask)
+                return p + __builtin_ctz(mask);
+        }
+
+        return sse2_find_string_special(p, end);
+    }
+
+    constexpr Kernels avx2_kernels = {
+        avx2_skip_spaces,
+        avx2_skip_identifier,
+        avx2_find_newline,
+        avx2_find_string_special};
+    // - - - - - - - - - - - - - //
+#endif
+
+    const Kernels &kernels_for(simd::Level level)
+    {
+        switch (level)
+        {
+#ifdef SHIFT_SIMD_X86
+        case simd::Level::AVX2:
+            return avx2_kernels;
+        case simd::Level::SSE2:
+            return sse2_kernels;
+#endif
+        default:
+            return scalar_kernels;
+        }
+    }
+
+    simd::Level active_level = simd::detect();
+    const Kernels *active = &kernels_for(active_level);
+}
+
+
+simd::Level simd::detect()
+{
+#ifdef SHIFT_SIMD_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+        return Level::AVX2;
+
+    if (__builtin_cpu_supports("sse2"))
+        return Level::SSE2;
+#endif
+
+    return Level::Scalar;
+}
+
+simd::Level simd::level() { return active_level; }
+
+void simd::set_level(Level level)
+{
+    // never go above what the CPU supports
+    if (level > detect())
+        level = detect();
+
+    active_level = level;
+    active = &kernels_for(level);
+}
+
+std::string_view simd::level_name(Level level)
+{
+    switch (level)
+    {
+    case Level::AVX2:
+        return "avx2";
+    case Level::SSE2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
+
+const char *simd::skip_spaces(const char *begin, const char *end) { return active->skip_spaces(begin, end); }
+const char *simd::skip_identifier(const char *begin, const char *end) { return active->skip_identifier(begin, end); }
+const char *simd::find_newline(const char *begin, const char *end) { return active->find_newline(begin, end); }
+const char *simd::find_string_special(const char *begin, const char *end) { return active->find_string_special(begin, end); }
@@ -4,7 +4,7 @@
 #include "lexer.h"
 
 
-Token::Token(TokenType type, Position position, std::string lexeme)
+Token::Token(TokenType type, Position position, std::string_view lexeme)
 {
     this->type = type;
     this->position = position;
@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <optional>
+
+#include "lld/Common/Driver.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/TargetParser/Host.h"
+#include "llvm/TargetParser/Triple.h"
+
+#include "linker.h"
+
+LLD_HAS_DRIVER(elf)
+
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    // Where the C library and the compiler runtime live on this system. Looked
+    // up once, instead of asking the gcc driver on every link.
+    struct SystemRuntime
+    {
+        std::string arch;
+        std::vector<std::string> libraryPaths;
+        // gcc's crtbeginS.o, crtendS.o and libgcc, empty if there is no gcc
+        std::string gccPath;
+    };
+
+    // "12.2.0" > "9.4.0"
+    bool newer_version(const fs::path &a, const fs::path &b)
+    {
+        std::string x = a.filename().string(), y = b.filename().string();
+        int majorX = std::atoi(x.c_str()), majorY = std::atoi(y.c_str());
+
+        return majorX != majorY ? majorX > majorY : x > y;
+    }
+
+    const SystemRuntime &system_runtime()
+    {
+        static const SystemRuntime runtime = [] {
+            SystemRuntime runtime;
+            runtime.arch = llvm::Triple(llvm::sys::getDefaultTargetTriple()).getArchName().str();
+
+            std::string multiarch = runtime.arch + "-linux-gnu";
+            std::vector<std::string> candidates = { "/usr/lib/" + multiarch, "/lib/" + multiarch, "/usr/lib64", "/lib64", "/usr/lib", "/lib" };
+            for (const auto &path : candidates)
+                if (fs::is_directory(path))
+                    runtime.libraryPaths.push_back(path);
+
+            std::error_code error;
+            std::vector<fs::path> versions;
+            for (auto &vendor : fs::directory_iterator("/usr/lib/gcc", error))
+                if (vendor.path().filename().string().starts_with(runtime.arch + "-"))
+                    for (auto &version : fs::directory_iterator(vendor.path(), error))
+                        if (fs::exists(version.path() / "crtbeginS.o"))
+                            versions.push_back(version.path());
+
+            std::sort(versions.begin(), versions.end(), newer_version);
+            if (!versions.empty())
+                runtime.gccPath = versions.front().string();
+
+            return runtime;
+        }();
+
+        return runtime;
+    }
+
+    std::optional<std::string> find_file(const std::string &name, const std::vector<std::string> &paths)
+    {
+        for (const auto &path : paths)
+            if (fs::exists(fs::path(path) / name))
+                return (fs::path(path) / name).string();
+
+        return std::nullopt;
+    }
+
+    std::optional<std::string> dynamic_linker(const std::string &arch)
+    {
+        if (arch == "x86_64")
+            return "/lib64/ld-linux-x86-64.so.2";
+        if (arch == "aarch64")
+            return "/lib/ld-linux-aarch64.so.1";
+
+        return std::nullopt;
+    }
+
+    // Same inputs, in the same order, as the gcc driver passes to ld for a PIE
+    std::optional<std::vector<std::string>> lld_arguments(
+        const std::vector<std::string> &objects,
+        const std::string &output,
+        const LinkOptions &options)
+    {
+        const SystemRuntime &runtime = system_runtime();
+
+        std::vector<std::string> paths = options.libraryPaths;
+        if (!runtime.gccPath.empty())
+            paths.push_back(runtime.gccPath);
+        paths.insert(paths.end(), runtime.libraryPaths.begin(), runtime.libraryPaths.end());
+
+        auto start = find_file("Scrt1.o", paths);
+        auto init = find_file("crti.o", paths);
+        auto fini = find_file("crtn.o", paths);
+        auto loader = dynamic_linker(runtime.arch);
+
+        if (!start || !init || !fini)
+        {
+            std::cerr << "Could not find the C runtime (Scrt1.o, crti.o, crtn.o). Add its directory with -L, or link with -fuse-ld=gcc.\n";
+            return std::nullopt;
+        }
+
+        if (!loader)
+        {
+            std::cerr << "No known dynamic linker for '" << runtime.arch << "', link with -fuse-ld=gcc.\n";
+            return std::nullopt;
+        }
+
+        std::vector<std::string> args = {
+            "--hash-style=gnu", "--build-id", "--eh-frame-hdr", "-pie",
+            "-dynamic-linker", *loader,
+            "-o", output,
+            *start, *init
+        };
+
+        auto begin = find_file("crtbeginS.o", paths);
+        auto end = find_file("crtendS.o", paths);
+        if (begin)
+            args.push_back(*begin);
+
+        for (const auto &path : paths)
+            args.push_back("-L" + path);
+
+        if (options.lto)
+        {
+            args.push_back(std::format("--lto-O{}", options.ltoOptLevel));
+            args.push_back(std::format("--thinlto-jobs={}", options.ltoJobs));
+
+            // unchanged modules skip their backend on the next link
+            if (!options.ltoCacheDirectory.empty())
+            {
+                args.push_back("--thinlto-cache-dir=" + options.ltoCacheDirectory);
+                if (options.ltoCacheSize)
+                    args.push_back(std::format("--thinlto-cache-policy=cache_size_bytes={}", options.ltoCacheSize));
+            }
+        }
+
+        args.insert(args.end(), objects.begin(), objects.end());
+
+        // "x ** y" on floats calls pow
+        args.insert(args.end(), { "--as-needed", "-lm", "--no-as-needed" });
+        args.push_back("-lc");
+
+        if (!runtime.gccPath.empty())
+            args.insert(args.end(), { "-lgcc", "--as-needed", "-lgcc_s", "--no-as-needed" });
+
+        if (end)
+            args.push_back(*end);
+        args.push_back(*fini);
+
+        return args;
+    }
+
+    bool link_with_gcc(const std::vector<std::string> &objects, const std::string &output, const LinkOptions &options)
+    {
+        std::string linkCommand = "gcc";
+        for (const auto &path : options.libraryPaths)
+            linkCommand += " -L" + path;
+        for (const auto &object : objects)
+            linkCommand += " " + object;
+        linkCommand += " -lm -o " + output;
+
+        int linkResult = std::system(linkCommand.c_str());
+        if (linkResult != 0)
+        {
+            std::cerr << "Linking failed with exit code " << linkResult << "\n";
+            return false;
+        }
+
+        return true;
+    }
+}
+
+
+bool link_executable(const std::vector<std::string> &objects, const std::string &output, const LinkOptions &options)
+{
+    if (options.systemLinker && options.lto)
+    {
+        std::cerr << "LTO objects are LLVM bitcode, which only the built-in lld can link.\n";
+        return false;
+    }
+
+    if (options.systemLinker)
+        return link_with_gcc(objects, output, options);
+
+    auto args = lld_arguments(objects, output, options);
+    if (!args)
+        return false;
+
+    std::vector<const char *> argv = { "ld.lld" };
+    for (const auto &arg : *args)
+        argv.push_back(arg.c_str());
+
+    // lld keeps global state, after a fatal error it can't be used again in
+    // this process, which only matters to callers that link more than once
+    lld::Result result = lld::lldMain(argv, llvm::outs(), llvm::errs(), { { lld::Gnu, &lld::elf::link } });
+
+    if (result.retCode != 0)
+    {
+        std::cerr << "Linking failed with exit code " << result.retCode << "\n";
+        return false;
+    }
+
+    return true;
+}
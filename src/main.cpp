@@ -1,51 +1,155 @@
-#include <map>
-#include <filesystem>
+#include <cstdlib>
 #include <iostream>
-#include <fstream>
-
-#include "llvm/IR/LegacyPassManager.h"
-#include "llvm/MC/TargetRegistry.h"
-#include "llvm/Target/TargetOptions.h"
-#include "llvm/Target/TargetMachine.h"
-#include "llvm/TargetParser/Host.h"
-#include "llvm/Support/Format.h"
-#include "llvm/Support/raw_os_ostream.h"
-#include "llvm/Support/TargetSelect.h"
-#include "llvm/Support/FileSystem.h"
-#include "llvm/Transforms/InstCombine/InstCombine.h"
-#include "llvm/Transforms/Scalar.h"
-#include "llvm/Transforms/Scalar/GVN.h"
-#include "llvm/Transforms/Scalar/Reassociate.h"
-#include "llvm/Transforms/Scalar/SimplifyCFG.h"
-#include "llvm/Passes/PassBuilder.h"
-#include "llvm/Passes/StandardInstrumentations.h"
-
-#include "generator.h"
+#include <string>
+#include <vector>
+
 #include "compiler.h"
 
 
-std::unique_ptr<llvm::LLVMContext> CodegenVisitor::context = std::make_unique<llvm::LLVMContext>();
-std::unique_ptr<llvm::Module> CodegenVisitor::module = std::make_unique<llvm::Module>("main", *context);
+int main(int argc, char *argv[])
+{
+    CompileOptions options;
+    std::vector<std::string> paths;
 
-std::unique_ptr<llvm::FunctionPassManager> CodegenVisitor::theFPM = std::make_unique<llvm::FunctionPassManager>();
-std::unique_ptr<llvm::LoopAnalysisManager> CodegenVisitor::theLAM = std::make_unique<llvm::LoopAnalysisManager>();
-std::unique_ptr<llvm::FunctionAnalysisManager> CodegenVisitor::theFAM = std::make_unique<llvm::FunctionAnalysisManager>();
-std::unique_ptr<llvm::CGSCCAnalysisManager> CodegenVisitor::theCGAM = std::make_unique<llvm::CGSCCAnalysisManager>();
-std::unique_ptr<llvm::ModuleAnalysisManager> CodegenVisitor::theMAM = std::make_unique<llvm::ModuleAnalysisManager>();
-std::unique_ptr<llvm::PassInstrumentationCallbacks> CodegenVisitor::thePIC = std::make_unique<llvm::PassInstrumentationCallbacks>();
-std::unique_ptr<llvm::StandardInstrumentations> CodegenVisitor::theSI = std::make_unique<llvm::StandardInstrumentations>(*context, true);
+    // "shift run file.shf" runs the program in-process instead of building an
+    // executable, "shift cache" shows the compile cache's statistics
+    std::string command = argc > 1 ? argv[1] : "";
+    bool runMode = command == "run";
+    bool cacheMode = command == "cache";
 
+    for (int i = runMode || cacheMode ? 2 : 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
 
-int main(int argc, char *argv[])
-{
-    if (argc != 2)
+        // -j N or -jN
+        if (arg.starts_with("-j") && arg != "-")
+        {
+            std::string value = arg.size() > 2 ? arg.substr(2) : (i + 1 < argc ? argv[++i] : "");
+            int jobs = std::atoi(value.c_str());
+
+            if (jobs <= 0)
+            {
+                std::cerr << "Invalid job count '" << value << "'.\n";
+                return 1;
+            }
+
+            options.jobs = jobs;
+            options.partitions = jobs;
+        }
+        // -O0, -O1, -O2, -O3, -Os, -Oz
+        else if (arg.starts_with("-O"))
+        {
+            auto level = parse_opt_level(arg.substr(2));
+
+            if (!level)
+            {
+                std::cerr << "Invalid optimization level '" << arg << "'.\n";
+                return 1;
+            }
+
+            options.codegen.optLevel = *level;
+        }
+        // -march=<cpu> and -mcpu=<cpu> both pick the CPU, "native" for the host
+        else if (arg.starts_with("-march=") || arg.starts_with("-mcpu="))
+        {
+            std::string cpu = arg.substr(arg.find('=') + 1);
+
+            if (cpu.empty())
+            {
+                std::cerr << "Missing CPU name in '" << arg << "'.\n";
+                return 1;
+            }
+
+            options.codegen.cpu = cpu;
+        }
+        // -mattr=+avx2,-bmi, can be repeated
+        else if (arg.starts_with("-mattr="))
+        {
+            if (!options.codegen.features.empty())
+                options.codegen.features += ',';
+
+            options.codegen.features += arg.substr(7);
+        }
+        // -L <dir> or -L<dir>, searched for the C runtime and libraries
+        else if (arg.starts_with("-L"))
+        {
+            std::string dir = arg.size() > 2 ? arg.substr(2) : (i + 1 < argc ? argv[++i] : "");
+
+            if (dir.empty())
+            {
+                std::cerr << "Missing directory after '-L'.\n";
+                return 1;
+            }
+
+            options.link.libraryPaths.push_back(dir);
+        }
+        // -fuse-ld=lld links in-process (the default), -fuse-ld=gcc through the gcc driver
+        else if (arg.starts_with("-fuse-ld="))
+        {
+            std::string linker = arg.substr(9);
+
+            if (linker != "lld" && linker != "gcc")
+            {
+                std::cerr << "Unknown linker '" << linker << "'.\n";
+                return 1;
+            }
+
+            options.link.systemLinker = linker == "gcc";
+        }
+        // one object per function, only changed functions are compiled again
+        else if (arg == "--incremental")
+            options.incremental = true;
+        // -flto and -flto=full link one whole-program module, -flto=thin
+        // imports across modules and keeps them separate
+        else if (arg == "-flto" || arg == "-flto=full")
+            options.codegen.lto = LTOMode::Full;
+        else if (arg == "-flto=thin")
+            options.codegen.lto = LTOMode::Thin;
+        else if (arg == "-fno-lto")
+            options.codegen.lto = LTOMode::None;
+        else if (arg.starts_with("-flto="))
+        {
+            std::cerr << "Unknown LTO mode '" << arg.substr(6) << "'.\n";
+            return 1;
+        }
+        else if (arg == "-ffast-math")
+            options.codegen.fastMath = true;
+        else if (arg == "-fno-fast-math")
+            options.codegen.fastMath = false;
+        else if (arg == "-fbounds-check")
+            options.codegen.boundsCheck = true;
+        else if (arg == "-fno-bounds-check")
+            options.codegen.boundsCheck = false;
+        else if (arg == "--no-cache")
+            options.cacheDirectory.clear();
+        else if (arg.starts_with("--cache-dir="))
+            options.cacheDirectory = arg.substr(12);
+        // --cache-size=<MiB>
+        else if (arg.starts_with("--cache-size="))
+        {
+            long long size = std::atoll(arg.c_str() + 13);
+
+            if (size <= 0)
+            {
+                std::cerr << "Invalid cache size '" << arg.substr(13) << "'.\n";
+                return 1;
+            }
+
+            options.cacheSize = static_cast<uint64_t>(size) << 20;
+        }
+        else
+            paths.push_back(arg);
+    }
+
+    if (cacheMode)
+        return print_cache_stats(options);
+
+    // the JIT runs a single file
+    if (paths.empty() || (runMode && paths.size() > 1))
     {
         std::cerr << "Invalid usage.\n";
         return 1;
     }
 
-    compile(argv[1]);
-    CodegenVisitor::module->print(llvm::errs(), nullptr);
-
-    return 0;
+    return runMode ? run(paths.front(), options) : compile(paths, options);
 }
@@ -1,9 +1,24 @@
+#include <charconv>
+#include <cstdint>
 #include <format>
 #include <sstream>
 #include <iostream>
 
 #include "parser.h"
 
+namespace
+{
+    // The smallest type that holds an integer literal. A negated one reaches
+    // one further, so "-2147483648" is an int and "-9223372036854775808" an i64.
+    Type integer_literal_type(uint64_t value, bool negated = false)
+    {
+        if (value <= uint64_t(INT32_MAX) + negated)
+            return Type::Int;
+
+        return value <= uint64_t(INT64_MAX) + negated ? Type::I64 : Type::U64;
+    }
+}
+
 bool Parser::valid_index() const { return idx >= 0 && idx < tokens.size(); }
 
 const Token &Parser::peek() const { return this->tokens[idx]; }
@@ -29,6 +44,19 @@ bool Parser::match(TokenType type)
     return false;
 }
 
+template <class T>
+std::span<T *> Parser::collect(size_t mark)
+{
+    std::span<T *> items = context.make_list<T>(scratch.size() - mark);
+
+    for (size_t i = 0; i < items.size(); ++i)
+        items[i] = static_cast<T *>(scratch[mark + i]);
+
+    scratch.resize(mark);
+
+    return items;
+}
+
 const Token &Parser::consume(TokenType expected, const std::string &error)
 {
     if (check(expected))
@@ -40,7 +68,7 @@ const Token &Parser::consume(TokenType expected, const std::string &error)
     throw std::runtime_error(message);
 }
 
-std::unique_ptr<Declaration> Parser::parse_declaration()
+Declaration *Parser::parse_declaration()
 {
     if (match(tok_extern))
     {
@@ -54,16 +82,16 @@ std::unique_ptr<Declaration> Parser::parse_declaration()
     throw std::runtime_error("Expected declaration (e.g. 'fn')");
 }
 
-std::unique_ptr<Declaration> Parser::parse_extern()
+Declaration *Parser::parse_extern()
 {
     auto proto = parse_prototype();
     consume(tok_delimiter, "Expected ';' after extern declaration");
     proto->isExtern = true;
 
-    return std::move(proto);
+    return proto;
 }
 
-std::unique_ptr<Declaration> Parser::parse_function()
+Declaration *Parser::parse_function()
 {
     auto proto = parse_prototype();
 
@@ -71,45 +99,37 @@ std::unique_ptr<Declaration> Parser::parse_function()
     if (check(tok_open_brace))
     {
         auto body = parse_block();
-        return std::make_unique<Definition>(std::move(proto), std::move(body));
+        return context.make<Definition>(proto, body);
     }
 
     consume(tok_delimiter, "Expected ';' after function prototype");
 
-    return std::move(proto);
+    return proto;
 }
 
-std::unique_ptr<Parameter> Parser::parse_parameter()
+Parameter *Parser::parse_parameter()
 {
     consume(tok_identifier, "Expected identifier");
-    std::string name = prev().lexeme;
+    Identifier name = prev().identifier;
 
     Type type = Type::Unknown;
     if (match(tok_colon))
-    {
-        if (token_to_type.find(peek().type) != token_to_type.end())
-        {
-            type = token_to_type.at(peek().type);
-            advance();
-        }
-        else
-            throw std::runtime_error("Expected a type after ':' in parameter");
-    }
+        type = parse_type("Expected a type after ':' in parameter");
 
-    std::unique_ptr<Expr> init = nullptr;
+    Expr *init = nullptr;
     if (match(tok_assignment))
         init = parse_expression();
 
-    return std::make_unique<Parameter>(name, type, std::move(init));
+    return context.make<Parameter>(name, type, init);
 }
 
-std::unique_ptr<Prototype> Parser::parse_prototype()
+Prototype *Parser::parse_prototype()
 {
-    std::string name = consume(tok_identifier, "Expected function name").lexeme;
+    Identifier name = consume(tok_identifier, "Expected function name").identifier;
 
     consume(tok_open_paren, "Expected '(' after function name");
 
-    std::vector<std::unique_ptr<Parameter>> args;
+    size_t mark = scratch.size();
     bool isVarArg = false;
 
     if (!check(tok_close_paren))
@@ -122,82 +142,114 @@ std::unique_ptr<Prototype> Parser::parse_prototype()
                 break;
             }
 
-            auto arg = parse_parameter();
-            args.push_back(std::move(arg));
+            scratch.push_back(parse_parameter());
         } while (match(tok_comma));
     }
 
     consume(tok_close_paren, "Expected ')' after parameters");
+    std::span<Parameter *> args = collect<Parameter>(mark);
 
     Type retType = Type::Void;
     if (match(tok_arrow))
-    {
-        if (token_to_type.find(peek().type) != token_to_type.end())
-        {
-            retType = token_to_type.at(peek().type);
-            advance();
-        }
-        else
-            throw std::runtime_error("Expected a type after '->' in function prototype");
-    }
+        retType = parse_type("Expected a type after '->' in function prototype");
 
-    auto proto = std::make_unique<Prototype>(retType, name, std::move(args));
+    auto proto = context.make<Prototype>(retType, name, args);
     proto->isVarArg = isVarArg;
 
     return proto;
 }
 
-std::unique_ptr<Block> Parser::parse_block()
+Type Parser::parse_type(const std::string &error)
+{
+    if (auto found = token_to_type.find(peek().type); found != token_to_type.end())
+    {
+        advance();
+        return found->second;
+    }
+
+    if (!match(tok_open_bracket))
+        throw std::runtime_error(error);
+
+    bool slice = match(tok_close_bracket);
+    Type element = parse_type("Expected an element type in array type");
+
+    if (is_composite(element))
+        throw std::runtime_error("Arrays of arrays or slices aren't supported");
+
+    // "[]T"
+    if (slice)
+        return slice_type(element);
+
+    // "[T; N]"
+    consume(tok_delimiter, "Expected ';' between the element type and the length of an array");
+
+    // "[T; SIZE]" with a constant, its value is only known to the analyzer
+    if (match(tok_identifier))
+    {
+        Identifier name = prev().identifier;
+        consume(tok_close_bracket, "Expected ']' after the length of an array");
+
+        return named_array_type(element, name);
+    }
+
+    std::string_view lexeme = consume(tok_number, "Expected the length of the array").lexeme;
+    uint32_t length = 0;
+    auto [end, ec] = std::from_chars(lexeme.data(), lexeme.data() + lexeme.size(), length);
+
+    if (ec != std::errc() || end != lexeme.data() + lexeme.size() || length == 0 || length > INT32_MAX)
+        throw std::runtime_error(std::format("Invalid array length '{}'", lexeme));
+
+    consume(tok_close_bracket, "Expected ']' after the length of an array");
+
+    return array_type(element, length);
+}
+
+Block *Parser::parse_block()
 {
     consume(tok_open_brace, "Expected '{' before block");
 
-    std::vector<std::unique_ptr<Statement>> statements;
+    size_t mark = scratch.size();
     while (!check(tok_close_brace) && valid_index())
     {
-        statements.push_back(parse_statement());
+        scratch.push_back(parse_statement());
     }
 
     consume(tok_close_brace, "Expected '}' after block");
+    std::span<Statement *> statements = collect<Statement>(mark);
 
-    return std::make_unique<Block>(std::move(statements));
+    return context.make<Block>(statements);
 }
 
-std::unique_ptr<VariableDecl> Parser::parse_variable_decl()
+VariableDecl *Parser::parse_variable_decl()
 {
-    consume(tok_let, "Expected 'let' before variable declaration");
+    bool isConst = match(tok_const);
+    if (!isConst)
+        consume(tok_let, "Expected 'let' or 'const' before variable declaration");
 
     consume(tok_identifier, "Expected identifier");
-    std::string name = prev().lexeme;
+    Identifier name = prev().identifier;
 
     Type type = Type::Unknown;
     if (match(tok_colon))
-    {
-        if (token_to_type.find(peek().type) != token_to_type.end())
-        {
-            type = token_to_type.at(peek().type);
-            advance();
-        }
-        else
-            throw std::runtime_error("Expected a type after ':' in variable declaration");
-    }
+        type = parse_type("Expected a type after ':' in variable declaration");
 
-    std::unique_ptr<Expr> init = nullptr; 
+    Expr *init = nullptr;
     if (match(tok_assignment))
-        init = std::move(parse_expression());
+        init = parse_expression();
 
     consume(tok_delimiter, "Expected ';' after variable declaration");
 
-    return std::make_unique<VariableDecl>(name, type, std::move(init));
+    auto declaration = context.make<VariableDecl>(name, type, init);
+    declaration->isConst = isConst;
+
+    return declaration;
 }
 
-std::unique_ptr<Statement> Parser::parse_statement()
+Statement *Parser::parse_statement()
 {
-    if (check(tok_let))
+    if (check(tok_let) || check(tok_const))
         return parse_variable_decl();
 
-    if (check(tok_identifier) && next().type == tok_assignment)
-        return parse_assignment();
-
     if (match(tok_return))
         return parse_return_stmt();
 
@@ -208,40 +260,58 @@ std::unique_ptr<Statement> Parser::parse_statement()
         return parse_while_stmt();
 
     auto expr = parse_expression();
+
+    // "x = ..." or "a[i] = ..."
+    if (check(tok_assignment))
+        return parse_assignment(expr);
+
     consume(tok_delimiter, "Expected ';' after expression.");
-    return std::make_unique<ExprStatement>(std::move(expr));
+    return context.make<ExprStatement>(expr);
 }
 
-std::unique_ptr<Assignment> Parser::parse_assignment()
+Assignment *Parser::parse_assignment(Expr *target)
 {
-    std::unique_ptr<Variable> var = parse_variable();
-    consume(tok_assignment, "Expected '=' after assignment identifier");
+    if (target->kind != NodeKind::Variable && target->kind != NodeKind::Index)
+        throw std::runtime_error("Only variables and array elements can be assigned");
+
+    consume(tok_assignment, "Expected '=' after assignment target");
 
-    std::unique_ptr<Expr> expr = parse_expression();
+    Expr *expr = parse_expression();
 
     consume(tok_delimiter, "Expected ';' after assignment");
 
-    return std::make_unique<Assignment>(std::move(var), std::move(expr));
+    return context.make<Assignment>(target, expr);
 }
 
-std::unique_ptr<Return> Parser::parse_return_stmt()
+Return *Parser::parse_return_stmt()
 {
     // return;
     if (match(tok_delimiter))
-        return std::make_unique<Return>(nullptr);
+        return context.make<Return>(nullptr);
 
     // return <expr>;
-    std::unique_ptr<Expr> expression = parse_expression();
+    Expr *expression = parse_expression();
     consume(tok_delimiter, "Expected ';' after return");
 
-    return std::make_unique<Return>(std::move(expression));
+    return context.make<Return>(expression);
 }
 
-std::unique_ptr<If> Parser::parse_if_stmt()
+BranchHint Parser::parse_branch_hint()
 {
-    std::unique_ptr<Expr> condition;
-    std::unique_ptr<Block> then_block;
-    std::unique_ptr<Block> else_block = nullptr;
+    if (match(tok_likely))
+        return BranchHint::Likely;
+    if (match(tok_unlikely))
+        return BranchHint::Unlikely;
+
+    return BranchHint::None;
+}
+
+If *Parser::parse_if_stmt()
+{
+    Expr *condition;
+    Block *then_block;
+    Block *else_block = nullptr;
+    BranchHint hint = parse_branch_hint();
 
     consume(tok_open_paren, "Expected '(' before 'if' condition");
     condition = parse_expression();
@@ -250,26 +320,30 @@ std::unique_ptr<If> Parser::parse_if_stmt()
     if (check(tok_open_brace))
         then_block = parse_block();
     else
-        then_block = std::make_unique<Block>(parse_statement());
+        then_block = context.make<Block>(context.list<Statement>({parse_statement()}));
 
     if (match(tok_else))
     {
         if (check(tok_open_brace))
             else_block = parse_block();
         else
-            else_block = std::make_unique<Block>(parse_statement());
+            else_block = context.make<Block>(context.list<Statement>({parse_statement()}));
     }
 
-    return std::make_unique<If>(
-        std::move(condition),
-        std::move(then_block),
-        std::move(else_block));
+    auto statement = context.make<If>(
+        condition,
+        then_block,
+        else_block);
+    statement->hint = hint;
+
+    return statement;
 }
 
-std::unique_ptr<While> Parser::parse_while_stmt()
+While *Parser::parse_while_stmt()
 {
-    std::unique_ptr<Expr> condition;
-    std::unique_ptr<Block> body;
+    Expr *condition;
+    Block *body;
+    BranchHint hint = parse_branch_hint();
 
     consume(tok_open_paren, "Expected '(' before 'while' condition");
     condition = parse_expression();
@@ -278,14 +352,17 @@ std::unique_ptr<While> Parser::parse_while_stmt()
     if (check(tok_open_brace))
         body = parse_block();
     else
-        body = std::make_unique<Block>(parse_statement());
+        body = context.make<Block>(context.list<Statement>({parse_statement()}));
+
+    auto statement = context.make<While>(
+        condition,
+        body);
+    statement->hint = hint;
 
-    return std::make_unique<While>(
-        std::move(condition),
-        std::move(body));
+    return statement;
 }
 
-std::unique_ptr<Expr> Parser::parse_expression(int precedence)
+Expr *Parser::parse_expression(int precedence)
 {
     auto lhs = parse_unary_expr();
 
@@ -296,26 +373,59 @@ std::unique_ptr<Expr> Parser::parse_expression(int precedence)
             break;
 
         const Token &op = advance();
-        auto rhs = parse_expression(current_prec + 1);
-        lhs = std::make_unique<BinaryOp>(token_to_binary_op.at(op.type), std::move(lhs), std::move(rhs));
+
+        // "**" groups to the right, "2 ** 3 ** 2" is "2 ** 9"
+        auto rhs = parse_expression(op.type == tok_exponentiation ? current_prec : current_prec + 1);
+        lhs = context.make<BinaryOp>(token_to_binary_op.at(op.type), lhs, rhs);
     }
 
     return lhs;
 }
 
-std::unique_ptr<Expr> Parser::parse_primary()
+Expr *Parser::parse_primary()
 {
     if (match(tok_number))
-        return std::make_unique<Number>(std::stod(prev().lexeme));
+    {
+        std::string_view lexeme = prev().lexeme;
+        const char *end = lexeme.data() + lexeme.size();
+
+        if (lexeme.find_first_of(".eE") != std::string_view::npos)
+        {
+            double real = 0;
+            std::from_chars(lexeme.data(), end, real);
+
+            return context.make<Number>(real, Type::F64);
+        }
+
+        uint64_t value = 0;
+        if (std::from_chars(lexeme.data(), end, value).ec != std::errc())
+            throw std::runtime_error(std::format("Integer literal '{}' is out of range", lexeme));
+
+        return context.make<Number>(value, integer_literal_type(value));
+    }
 
     if (match(tok_string))
-        return std::make_unique<String>(prev().lexeme);
+        return context.make<String>(context.store(prev().lexeme));
 
     if (match(tok_true))
-        return std::make_unique<Boolean>(true);
+        return context.make<Boolean>(true);
 
     if (match(tok_false))
-        return std::make_unique<Boolean>(false);
+        return context.make<Boolean>(false);
+
+    // conversion to a numeric type, e.g. "f64(n)", or a new slice, "[]int(n)"
+    bool sliceType = check(tok_open_bracket) && next().type == tok_close_bracket;
+    if (sliceType || (token_to_type.contains(peek().type) && next().type == tok_open_paren))
+    {
+        Type type = parse_type("Expected a type");
+
+        consume(tok_open_paren, "Expected '(' after type in conversion");
+        auto conversion = context.make<UnaryOp>(unary_convert, parse_expression());
+        consume(tok_close_paren, "Expected ')' after conversion");
+
+        conversion->type = type;
+        return conversion;
+    }
 
     if (check(tok_identifier))
     {
@@ -334,69 +444,106 @@ std::unique_ptr<Expr> Parser::parse_primary()
         return expr;
     }
 
+    if (match(tok_open_bracket))
+    {
+        size_t mark = scratch.size();
+        do
+        {
+            scratch.push_back(parse_expression());
+        } while (match(tok_comma));
+
+        consume(tok_close_bracket, "Expected ']' after array elements");
+
+        return context.make<ArrayLiteral>(collect<Expr>(mark));
+    }
+
     throw std::runtime_error("Expected expression.");
 }
 
-std::unique_ptr<Expr> Parser::parse_unary_expr()
+Expr *Parser::parse_postfix_expr()
+{
+    Expr *expr = parse_primary();
+
+    while (match(tok_open_bracket))
+    {
+        Expr *index = parse_expression();
+        consume(tok_close_bracket, "Expected ']' after index");
+
+        expr = context.make<Index>(expr, index);
+    }
+
+    return expr;
+}
+
+Expr *Parser::parse_unary_expr()
 {
     if (match(tok_plus))
-        return std::make_unique<UnaryOp>(unary_add, parse_unary_expr());
+        return context.make<UnaryOp>(unary_add, parse_unary_expr());
 
     if (match(tok_minus))
-        return std::make_unique<UnaryOp>(unary_sub, parse_unary_expr());
+    {
+        Expr *operand = parse_unary_expr();
+
+        if (operand->kind == NodeKind::Number && operand->type != Type::F64)
+            operand->type = integer_literal_type(static_cast<Number *>(operand)->value, true);
+
+        return context.make<UnaryOp>(unary_sub, operand);
+    }
 
     if (match(tok_not))
-        return std::make_unique<UnaryOp>(unary_not, parse_unary_expr());
+        return context.make<UnaryOp>(unary_not, parse_unary_expr());
 
     if (match(tok_tilde))
-        return std::make_unique<UnaryOp>(unary_bit_not, parse_unary_expr());
+        return context.make<UnaryOp>(unary_bit_not, parse_unary_expr());
 
-    return parse_primary();
+    return parse_postfix_expr();
 }
 
-std::unique_ptr<CallExpr> Parser::parse_call_expr()
+CallExpr *Parser::parse_call_expr()
 {
     consume(tok_identifier, "Expected identifier");
-    std::string name = prev().lexeme;
+    Identifier name = prev().identifier;
 
     consume(tok_open_paren, "Expected '(' before function call args");
 
-    std::vector<std::unique_ptr<Expr>> args;
+    size_t mark = scratch.size();
     if (!check(tok_close_paren))
     {
         do
         {
-            auto expr = parse_expression();
-            args.push_back(std::move(expr));
+            scratch.push_back(parse_expression());
         } while (match(tok_comma));
     }
 
     consume(tok_close_paren, "Expected ')' after function call args");
+    std::span<Expr *> args = collect<Expr>(mark);
 
-    return std::make_unique<CallExpr>(name, std::move(args));
+    return context.make<CallExpr>(name, args);
 }
 
-std::unique_ptr<Variable> Parser::parse_variable()
+Variable *Parser::parse_variable()
 {
     consume(tok_identifier, "Expected identifier");
-    std::string name = prev().lexeme;
+    Identifier name = prev().identifier;
 
-    return std::make_unique<Variable>(name);
+    return context.make<Variable>(name);
 }
 
-std::vector<std::unique_ptr<Declaration>> Parser::parse()
+std::span<Declaration *> Parser::parse()
 {
-    std::vector<std::unique_ptr<Declaration>> declarations;
+    size_t mark = scratch.size();
 
     while (this->valid_index())
     {
+        size_t first = idx;
         auto decl = parse_declaration();
 
         if (!decl)
             break;
 
-        declarations.push_back(std::move(decl));
+        scratch.push_back(decl);
+        declarationTokens.push_back(std::span(tokens).subspan(first, idx - first));
     }
 
-    return std::move(declarations);
-}
\ No newline at end of file
+    return collect<Declaration>(mark);
+}
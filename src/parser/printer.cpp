@@ -3,6 +3,19 @@
 
 using namespace ast;
 
+namespace
+{
+    const char *hint_name(BranchHint hint)
+    {
+        switch (hint)
+        {
+        case BranchHint::Likely: return "(likely)";
+        case BranchHint::Unlikely: return "(unlikely)";
+        default: return "";
+        }
+    }
+}
+
 void PrintVisitor::print_prefix(bool is_last)
 {
     for (size_t i = 0; i + 1 < indent_stack.size(); ++i)
@@ -26,19 +39,39 @@ void PrintVisitor::pop_indent()
 void PrintVisitor::visit(Number &node)
 {
     print_prefix(true);
-    out << "Number(" << node.value << "): " << type_to_str.at(node.type) << "\n";
+    out << "Number(";
+    // folded constants can be negative
+    if (is_float(node.type))
+        out << node.real;
+    else if (is_unsigned(node.type))
+        out << node.value;
+    else
+        out << static_cast<int64_t>(node.value);
+    out << "): " << type_name(node.type) << "\n";
 }
 
 void PrintVisitor::visit(String &node)
 {
     print_prefix(true);
-    out << "String(" << to_escaped_string(node.value) << "): " << type_to_str.at(node.type) << "\n";
+    out << "String(" << to_escaped_string(node.value) << "): " << type_name(node.type) << "\n";
 }
 
 void PrintVisitor::visit(Boolean &node)
 {
     print_prefix(true);
-    out << "Boolean(" << std::boolalpha << node.value << "): " << type_to_str.at(node.type) << "\n";
+    out << "Boolean(" << std::boolalpha << node.value << "): " << type_name(node.type) << "\n";
+}
+
+void PrintVisitor::visit(ArrayLiteral &node)
+{
+    print_prefix(true);
+    out << "ArrayLiteral: " << type_name(node.type) << "\n";
+    for (size_t i = 0; i < node.elements.size(); ++i)
+    {
+        push_indent(i == node.elements.size() - 1);
+        node.elements[i]->accept(*this);
+        pop_indent();
+    }
 }
 
 // Statements
@@ -46,7 +79,7 @@ void PrintVisitor::visit(VariableDecl &node)
 {
     print_prefix(false);
     
-    out << "VariableDecl(" << node.name << "): " << type_to_str.at(node.type) << "\n";
+    out << (node.isConst ? "ConstDecl(" : "VariableDecl(") << node.name << "): " << type_name(node.type) << "\n";
 
     push_indent(true);
     if (node.init)
@@ -69,7 +102,7 @@ void PrintVisitor::visit(Block &node)
 void PrintVisitor::visit(If &node)
 {
     print_prefix(true);
-    out << "If\n";
+    out << "If" << hint_name(node.hint) << "\n";
     push_indent(false);
     node.cond->accept(*this);
     pop_indent();
@@ -89,7 +122,7 @@ void PrintVisitor::visit(If &node)
 void PrintVisitor::visit(While &node)
 {
     print_prefix(true);
-    out << "While\n";
+    out << "While" << hint_name(node.hint) << "\n";
     push_indent(false);
     node.cond->accept(*this);
     pop_indent();
@@ -123,7 +156,7 @@ void PrintVisitor::visit(ExprStatement &node)
 void PrintVisitor::visit(Variable &node)
 {
     print_prefix(true);
-    out << "Variable(" << node.name << "): " << type_to_str.at(node.type) << "\n";
+    out << "Variable(" << node.name << "): " << type_name(node.type) << "\n";
 }
 
 void PrintVisitor::visit(Assignment &node)
@@ -142,7 +175,7 @@ void PrintVisitor::visit(Assignment &node)
 void PrintVisitor::visit(CallExpr &node)
 {
     print_prefix(true);
-    out << "CallExpr(" << node.callee << "): " << type_to_str.at(node.type) << "\n";
+    out << "CallExpr(" << node.callee << "): " << type_name(node.type) << "\n";
     for (size_t i = 0; i < node.args.size(); ++i)
     {
         push_indent(i == node.args.size() - 1);
@@ -154,7 +187,7 @@ void PrintVisitor::visit(CallExpr &node)
 void PrintVisitor::visit(BinaryOp &node)
 {
     print_prefix(true);
-    out << "BinaryOp(" << binop_to_str.at(node.op) << ")" << ": " << type_to_str.at(node.type) << "\n";
+    out << "BinaryOp(" << binop_to_str.at(node.op) << ")" << ": " << type_name(node.type) << "\n";
     push_indent(false);
     node.lhs->accept(*this);
     pop_indent();
@@ -167,21 +200,34 @@ void PrintVisitor::visit(BinaryOp &node)
 void PrintVisitor::visit(UnaryOp &node)
 {
     print_prefix(true);
-    out << "UnaryOp(" << unary_to_str.at(node.op) << ")" << ": " << type_to_str.at(node.type) << "\n";
+    out << "UnaryOp(" << unary_to_str.at(node.op) << ")" << ": " << type_name(node.type) << "\n";
     push_indent(true);
     node.rhs->accept(*this);
     pop_indent();
 }
 
+void PrintVisitor::visit(Index &node)
+{
+    print_prefix(true);
+    out << "Index: " << type_name(node.type) << "\n";
+    push_indent(false);
+    node.base->accept(*this);
+    pop_indent();
+
+    push_indent(true);
+    node.index->accept(*this);
+    pop_indent();
+}
+
 // Declarations
 void PrintVisitor::visit(Prototype &node)
 {
     print_prefix(true);
     
     if (node.isExtern)
-        out << "ExternFn(" << node.name << "): " << type_to_str.at(node.retType) << "\n";
+        out << "ExternFn(" << node.name << "): " << type_name(node.retType) << "\n";
     else
-        out << "Fn(" << node.name << "): " << type_to_str.at(node.retType) << "\n";
+        out << "Fn(" << node.name << "): " << type_name(node.retType) << "\n";
 
     for (size_t i = 0; i < node.args.size(); ++i)
     {
@@ -203,7 +249,7 @@ void PrintVisitor::visit(Parameter &node)
 {
     print_prefix(false);
     
-    out << "Arg(" << node.name << "): " << type_to_str.at(node.type) << "\n";
+    out << "Arg(" << node.name << "): " << type_name(node.type) << "\n";
 
     if (node.init)
     {
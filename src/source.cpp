@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "source.h"
+
+
+std::unique_ptr<SourceBuffer> SourceBuffer::open(const std::string &path)
+{
+    bool isStdin = path == "-";
+    int fd = isStdin ? STDIN_FILENO : ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+        throw std::runtime_error(std::format("Could not open '{}': {}", path, std::strerror(errno)));
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+    {
+        auto mapped = std::make_unique<MappedSource>(fd, static_cast<size_t>(info.st_size));
+
+        if (!isStdin)
+            close(fd);
+
+        return mapped;
+    }
+
+    return std::make_unique<StreamedSource>(fd, !isStdin);
+}
+
+
+MappedSource::MappedSource(int fd, size_t length)
+{
+    void *mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (mapping == MAP_FAILED)
+        throw std::runtime_error(std::format("Could not map source file: {}", std::strerror(errno)));
+
+    madvise(mapping, length, MADV_SEQUENTIAL);
+
+    data = static_cast<const char *>(mapping);
+    size = length;
+}
+
+MappedSource::~MappedSource()
+{
+    munmap(const_cast<char *>(data), size);
+}
+
+
+StreamedSource::StreamedSource(int fd, bool ownsFd) : fd(fd), ownsFd(ownsFd)
+{
+    // only address space is reserved here, pages get backed as chunks are written
+    for (size_t length = size_t(1) << 36; length >= CHUNK_SIZE; length /= 2)
+    {
+        void *mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+        if (mapping != MAP_FAILED)
+        {
+            region = static_cast<char *>(mapping);
+            reserved = length;
+            break;
+        }
+    }
+
+    if (region == nullptr)
+        throw std::runtime_error("Could not reserve memory for the source input");
+
+    data = region;
+}
+
+StreamedSource::~StreamedSource()
+{
+    munmap(region, reserved);
+
+    if (ownsFd)
+        close(fd);
+}
+
+bool StreamedSource::fill()
+{
+    if (eof)
+        return false;
+
+    if (size == reserved)
+        throw std::runtime_error("Source input is too large");
+
+    ssize_t count;
+    do
+        count = read(fd, region + size, std::min(CHUNK_SIZE, reserved - size));
+    while (count < 0 && errno == EINTR);
+
+    if (count < 0)
+        throw std::runtime_error(std::format("Could not read source input: {}", std::strerror(errno)));
+
+    if (count == 0)
+        eof = true;
+
+    size += count;
+
+    return !eof;
+}
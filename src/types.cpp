@@ -0,0 +1,116 @@
+#include <array>
+#include <atomic>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "types.h"
+
+
+namespace
+{
+    struct CompositeType
+    {
+        bool slice;
+        Type element;
+        uint32_t length;
+        // `length` is the id of the constant's name
+        bool named = false;
+    };
+
+    // Entries live in chunks that never move once allocated, and `count` is
+    // only raised after an entry is written. Lookups, which every check of a
+    // type does, read it without a lock; only interning locks.
+    class TypeTable
+    {
+        static constexpr size_t CHUNK_SIZE = 1024;
+        static constexpr size_t MAX_CHUNKS = 1024;
+
+        std::mutex mutex;
+        std::unordered_map<uint64_t, Type> ids;
+        std::array<std::unique_ptr<CompositeType[]>, MAX_CHUNKS> chunks;
+        std::atomic<size_t> count = 0;
+
+    public:
+        Type intern(const CompositeType &type)
+        {
+            uint64_t key = (uint64_t(type.length) << 32) | (uint64_t(static_cast<uint32_t>(type.element)) << 2) | (type.named << 1) | type.slice;
+
+            std::lock_guard lock(mutex);
+
+            auto found = ids.find(key);
+            if (found != ids.end())
+                return found->second;
+
+            size_t index = count.load(std::memory_order_relaxed);
+            if (index == CHUNK_SIZE * MAX_CHUNKS)
+                throw std::runtime_error("Too many array and slice types");
+
+            if (index % CHUNK_SIZE == 0)
+                chunks[index / CHUNK_SIZE] = std::make_unique<CompositeType[]>(CHUNK_SIZE);
+            chunks[index / CHUNK_SIZE][index % CHUNK_SIZE] = type;
+
+            Type id = static_cast<Type>(first_composite_type + index);
+            ids.emplace(key, id);
+            count.store(index + 1, std::memory_order_release);
+
+            return id;
+        }
+
+        CompositeType get(Type type) const
+        {
+            size_t index = static_cast<size_t>(static_cast<int>(type) - first_composite_type);
+
+            if (!is_composite(type) || index >= count.load(std::memory_order_acquire))
+                throw std::runtime_error("Not an array or slice type");
+
+            return chunks[index / CHUNK_SIZE][index % CHUNK_SIZE];
+        }
+    };
+
+    TypeTable &table()
+    {
+        static TypeTable types;
+        return types;
+    }
+}
+
+
+Type array_type(Type element, uint32_t length) { return table().intern({ false, element, length }); }
+Type slice_type(Type element) { return table().intern({ true, element, 0 }); }
+Type named_array_type(Type element, Identifier length) { return table().intern({ false, element, length.id, true }); }
+
+bool is_array(Type type) { return is_composite(type) && !table().get(type).slice; }
+bool is_slice(Type type) { return is_composite(type) && table().get(type).slice; }
+bool has_named_length(Type type) { return is_composite(type) && table().get(type).named; }
+
+Type element_type(Type type) { return table().get(type).element; }
+uint32_t array_length(Type type)
+{
+    CompositeType composite = table().get(type);
+
+    if (composite.named)
+        throw std::runtime_error(std::format("The length of {} isn't known yet", type_name(type)));
+
+    return composite.length;
+}
+
+Identifier length_name(Type type) { return Identifier{table().get(type).length}; }
+
+std::string type_name(Type type)
+{
+    if (!is_composite(type))
+        return type_to_str.at(type);
+
+    CompositeType composite = table().get(type);
+
+    if (composite.slice)
+        return "[]" + type_name(composite.element);
+
+    if (composite.named)
+        return std::format("[{}; {}]", type_name(composite.element), Identifier{composite.length}.str());
+
+    return std::format("[{}; {}]", type_name(composite.element), composite.length);
+}
@@ -1,9 +1,6 @@
-#include <iostream>
-#include <fstream>
-
 #include "utils.h"
 
-std::string to_escaped_string(const std::string& str)
+std::string to_escaped_string(std::string_view str)
 {
     std::string out = "";
 
@@ -19,20 +16,3 @@ std::string to_escaped_string(const std::string& str)
 
     return out;
 }
-
-std::string read_file(const std::string &path)
-{
-    std::ifstream file(path, std::ios::binary);
-
-    if (!file.is_open())
-        return "";
-
-    file.seekg(0, std::ios::end);
-    std::size_t size = file.tellg();
-    std::string buffer(size, '\0');
-    file.seekg(0);
-    file.read(&buffer[0], size);
-
-    file.close();
-    return buffer;
-}
\ No newline at end of file